@@ -0,0 +1,129 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+#ifndef AVOID_BBOXINDEX_H
+#define AVOID_BBOXINDEX_H
+
+#include <vector>
+#include <algorithm>
+
+#include "libavoid/geomtypes.h"
+#include "libavoid/assertions.h"
+
+
+namespace Avoid {
+
+
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// An index over the bounding boxes of a set of polygonal objects (obstacles
+// or clusters), used to answer point containment queries without testing
+// every polygon.  Entries are kept sorted by the left edge of their
+// bounding box, so a query only examines objects whose left edge lies
+// within the widest object's width of the query point.
+//
+// The index is rebuilt lazily.  Anything that changes the set of objects
+// or their polygons should call invalidate(), and the next query after that
+// must call rebuild() first.
+//
+template <typename T>
+class BBoxIndex
+{
+    public:
+        BBoxIndex()
+            : m_max_width(0),
+              m_valid(false)
+        {
+        }
+        void invalidate(void)
+        {
+            m_valid = false;
+        }
+        bool isValid(void) const
+        {
+            return m_valid;
+        }
+        template <typename InputIterator>
+        void rebuild(InputIterator first, InputIterator last)
+        {
+            m_entries.clear();
+            m_max_width = 0;
+            for (InputIterator curr = first; curr != last; ++curr)
+            {
+                Entry entry;
+                entry.object = *curr;
+                entry.object->polygon().getBoundingRect(&entry.minX,
+                        &entry.minY, &entry.maxX, &entry.maxY);
+                m_max_width = std::max(m_max_width, entry.maxX - entry.minX);
+                m_entries.push_back(entry);
+            }
+            std::sort(m_entries.begin(), m_entries.end());
+            m_valid = true;
+        }
+        // Appends to candidates every object whose bounding box contains
+        // (or has on its border) the point q.  Candidates still need an
+        // exact polygon containment test.
+        void candidatesContaining(const Point& q,
+                std::vector<T *>& candidates) const
+        {
+            COLA_ASSERT(m_valid);
+            Entry key;
+            key.minX = q.x;
+            typename std::vector<Entry>::const_iterator curr =
+                    std::upper_bound(m_entries.begin(), m_entries.end(), key);
+            const double leftLimit = q.x - m_max_width;
+            while (curr != m_entries.begin())
+            {
+                --curr;
+                if (curr->minX < leftLimit)
+                {
+                    break;
+                }
+                if ((q.x <= curr->maxX) && (q.y >= curr->minY) &&
+                        (q.y <= curr->maxY))
+                {
+                    candidates.push_back(curr->object);
+                }
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            bool operator<(const Entry& rhs) const
+            {
+                return minX < rhs.minX;
+            }
+
+            double minX;
+            double minY;
+            double maxX;
+            double maxY;
+            T *object;
+        };
+
+        std::vector<Entry> m_entries;
+        double m_max_width;
+        bool m_valid;
+};
+
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+
+
+#include <new>
+
+#include "libavoid/blockpool.h"
+#include "libavoid/assertions.h"
+
+namespace Avoid {
+
+
+static const size_t blocksPerChunk = 1024;
+
+
+BlockPool::BlockPool(const size_t objectSize)
+    : m_block_size(sizeof(BlockHeader) + 
+            ((objectSize + sizeof(BlockHeader) - 1) / sizeof(BlockHeader)) * 
+            sizeof(BlockHeader)),
+      m_current_chunk(0),
+      m_chunk_used(blocksPerChunk),
+      m_free_list(NULL),
+      m_blocks_in_use(0)
+{
+}
+
+
+BlockPool::~BlockPool()
+{
+    COLA_ASSERT(m_blocks_in_use == 0);
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+    {
+        ::operator delete(m_chunks[i]);
+    }
+}
+
+
+void *BlockPool::allocate(void)
+{
+    BlockHeader *header = NULL;
+#ifdef _OPENMP
+    #pragma omp critical(AvoidBlockPool)
+#endif
+    {
+        if (m_free_list)
+        {
+            // Reuse a freed block.  Its object storage holds the link.
+            header = ((BlockHeader *) m_free_list) - 1;
+            m_free_list = *((void **) m_free_list);
+        }
+        else
+        {
+            if (m_chunk_used == blocksPerChunk)
+            {
+                if (!m_chunks.empty())
+                {
+                    ++m_current_chunk;
+                }
+                if (m_current_chunk == m_chunks.size())
+                {
+                    m_chunks.push_back((char *) 
+                            ::operator new(m_block_size * blocksPerChunk));
+                }
+                m_chunk_used = 0;
+            }
+            header = (BlockHeader *) (m_chunks[m_current_chunk] + 
+                    (m_chunk_used * m_block_size));
+            ++m_chunk_used;
+        }
+        ++m_blocks_in_use;
+    }
+    header->pool = this;
+    return header + 1;
+}
+
+
+void BlockPool::free(void *object)
+{
+    if (object == NULL)
+    {
+        return;
+    }
+    BlockPool *pool = (((BlockHeader *) object) - 1)->pool;
+#ifdef _OPENMP
+    #pragma omp critical(AvoidBlockPool)
+#endif
+    {
+        *((void **) object) = pool->m_free_list;
+        pool->m_free_list = object;
+        --pool->m_blocks_in_use;
+    }
+}
+
+
+void BlockPool::reset(void)
+{
+    // Start handing out blocks from the first chunk again.  The free list 
+    // only links blocks within the chunks, so it can simply be dropped.
+    m_current_chunk = 0;
+    m_chunk_used = (m_chunks.empty()) ? blocksPerChunk : 0;
+    m_free_list = NULL;
+    m_blocks_in_use = 0;
+}
+
+
+size_t BlockPool::bytesAllocated(void) const
+{
+    return m_chunks.size() * blocksPerChunk * m_block_size;
+}
+
+
+size_t BlockPool::blocksInUse(void) const
+{
+    return m_blocks_in_use;
+}
+
+
+}
+
@@ -0,0 +1,80 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+
+#ifndef AVOID_BLOCKPOOL_H
+#define AVOID_BLOCKPOOL_H
+
+#include <cstddef>
+#include <vector>
+
+
+namespace Avoid {
+
+
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// Hands out fixed-size blocks of memory carved from large chunks, keeping
+// freed blocks on a free list for reuse.  Each block is preceded by a 
+// pointer back to its pool, so an object allocated from a pool can be freed
+// without knowing which pool it came from.  Allocation and freeing may be 
+// done from several OpenMP threads at once.
+//
+// A pool can also be used as an arena: reset() reclaims every block at
+// once, keeping the chunks for later allocations.
+//
+class BlockPool
+{
+    public:
+        BlockPool(const size_t objectSize);
+        ~BlockPool();
+        void *allocate(void);
+        static void free(void *object);
+        // Reclaims all blocks without running any destructors.  The caller
+        // must ensure that nothing still refers to objects in the pool.
+        void reset(void);
+        // Bytes of chunk memory held by the pool.
+        size_t bytesAllocated(void) const;
+        size_t blocksInUse(void) const;
+
+    private:
+        // Not copyable.
+        BlockPool(const BlockPool& other);
+        BlockPool& operator=(const BlockPool& other);
+
+        union BlockHeader
+        {
+            BlockPool *pool;
+            // Keeps the object that follows suitably aligned.
+            double alignment;
+        };
+
+        size_t m_block_size;
+        std::vector<char *> m_chunks;
+        // Chunks before m_current_chunk are full.
+        size_t m_current_chunk;
+        size_t m_chunk_used;
+        void *m_free_list;
+        size_t m_blocks_in_use;
+};
+
+
+}
+
+#endif
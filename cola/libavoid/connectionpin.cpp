@@ -66,6 +66,7 @@ ShapeConnectionPin::ShapeConnectionPin(ShapeRef *shape,
     }
 
     m_router = m_shape->router();
+    m_router->waitForAsyncTransactions();
     m_shape->addConnectionPin(this);
     
     // Create a visibility vertex for this ShapeConnectionPin.
@@ -103,6 +104,7 @@ ShapeConnectionPin::ShapeConnectionPin(JunctionRef *junction,
 {
     COLA_ASSERT(m_junction != NULL);
     m_router = m_junction->router();
+    m_router->waitForAsyncTransactions();
     m_junction->addConnectionPin(this);
     
     // Create a visibility vertex for this ShapeConnectionPin.
@@ -164,6 +166,7 @@ void ShapeConnectionPin::updateVisibility(void)
 
 void ShapeConnectionPin::setConnectionCost(const double cost)
 {
+    m_router->waitForAsyncTransactions();
     COLA_ASSERT(cost >= 0);
 
     m_connection_cost = cost;
@@ -172,6 +175,7 @@ void ShapeConnectionPin::setConnectionCost(const double cost)
 
 void ShapeConnectionPin::setExclusive(const bool exclusive)
 {
+    m_router->waitForAsyncTransactions();
     m_exclusive = exclusive;
 }
 
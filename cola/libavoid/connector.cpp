@@ -53,6 +53,8 @@ ConnRef::ConnRef(Router *router, const unsigned int id)
       m_active(false),
       m_initialised(false),
       m_hate_crossings(false),
+      m_search_region_valid(false),
+      m_endpoint_moved(false),
       m_route_dist(0),
       m_src_vert(NULL),
       m_dst_vert(NULL),
@@ -60,7 +62,8 @@ ConnRef::ConnRef(Router *router, const unsigned int id)
       m_callback_func(NULL),
       m_connector(NULL),
       m_src_connend(NULL),
-      m_dst_connend(NULL)
+      m_dst_connend(NULL),
+      m_search_region_epoch(0)
 {
     COLA_ASSERT(m_router != NULL);
     m_id = m_router->assignId(id);
@@ -83,13 +86,16 @@ ConnRef::ConnRef(Router *router, const ConnEnd& src, const ConnEnd& dst,
       m_active(false),
       m_initialised(false),
       m_hate_crossings(false),
+      m_search_region_valid(false),
+      m_endpoint_moved(false),
       m_route_dist(0),
       m_src_vert(NULL),
       m_dst_vert(NULL),
       m_callback_func(NULL),
       m_connector(NULL),
       m_src_connend(NULL),
-      m_dst_connend(NULL)
+      m_dst_connend(NULL),
+      m_search_region_epoch(0)
 {
     COLA_ASSERT(m_router != NULL);
     m_id = m_router->assignId(id);
@@ -167,6 +173,7 @@ ConnType ConnRef::routingType(void) const
 
 void ConnRef::setRoutingType(ConnType type)
 {
+    m_router->waitForAsyncTransactions();
     type = m_router->validConnType(type);
     if (m_type != type)
     {
@@ -187,6 +194,7 @@ std::vector<Point> ConnRef::routingCheckpoints(void) const
 
 void ConnRef::setRoutingCheckpoints(const std::vector<Point>& checkpoints)
 {
+    m_router->waitForAsyncTransactions();
     m_checkpoints = checkpoints;
     
     // Clear previous checkpoint vertices.
@@ -304,6 +312,8 @@ void ConnRef::common_updateEndPoint(const unsigned int type, ConnEnd connEnd)
     bool isConn = true;
     altered->removeFromGraph(isConn);
 
+    // Any existing route no longer reaches this end.
+    m_endpoint_moved = true;
     makePathInvalid();
     m_router->setStaticGraphInvalidated(true);
 }
@@ -503,7 +513,7 @@ bool ConnRef::setEndpoint(const unsigned int type, const VertID& pointID,
     common_updateEndPoint(type, point);
 
     // Give this visibility just to the point it is over.
-    EdgeInf *edge = new EdgeInf(
+    EdgeInf *edge = new (m_router) EdgeInf(
             (type == VertID::src) ? m_src_vert : m_dst_vert, vInf);
     // XXX: We should be able to set this to zero, but can't due to 
     //      assumptions elsewhere in the code.
@@ -537,6 +547,22 @@ void ConnRef::freeActivePins(void)
 }
 
 
+void ConnRef::extendSearchRegion(const Point& point)
+{
+    if (!m_search_region_valid)
+    {
+        m_search_region.a = point;
+        m_search_region.b = point;
+        m_search_region_valid = true;
+        return;
+    }
+    m_search_region.a.x = std::min(m_search_region.a.x, point.x);
+    m_search_region.a.y = std::min(m_search_region.a.y, point.y);
+    m_search_region.b.x = std::max(m_search_region.b.x, point.x);
+    m_search_region.b.y = std::max(m_search_region.b.y, point.y);
+}
+
+
 void ConnRef::makeInactive(void)
 {
     COLA_ASSERT(m_active);
@@ -710,6 +736,7 @@ void ConnRef::removeFromGraph(void)
 
 void ConnRef::setCallback(void (*cb)(void *), void *ptr)
 {
+    m_router->waitForAsyncTransactions();
     m_callback_func = cb;
     m_connector = ptr;
 }
@@ -845,6 +872,11 @@ bool ConnRef::generatePath(void)
 
     m_false_path = false;
     m_needs_reroute_flag = false;
+    m_endpoint_moved = false;
+
+    // The searches below will record the region they explore.
+    m_search_region_valid = false;
+    m_search_region_epoch = m_router->m_route_cache_epoch;
 
     m_start_vert = m_src_vert;
 
@@ -1167,6 +1199,7 @@ void ConnRef::generateStandardPath(std::vector<Point>& path,
 
 void ConnRef::setHateCrossings(bool value)
 {
+    m_router->waitForAsyncTransactions();
     m_hate_crossings = value;
 }
 
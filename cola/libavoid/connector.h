@@ -312,6 +312,8 @@ class ConnRef
         friend struct HyperEdgeTreeEdge;
         friend struct HyperEdgeTreeNode;
         friend class HyperedgeRerouter;
+        friend void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar,
+                VertInf *start);
 
         PolyLine& routeRef(void);
         void freeRoutes(void);
@@ -325,6 +327,7 @@ class ConnRef
         void updateEndPoint(const unsigned int type, const ConnEnd& connEnd);
         void common_updateEndPoint(const unsigned int type, ConnEnd connEnd);
         void freeActivePins(void);
+        void extendSearchRegion(const Point& point);
         bool getConnEndForEndpointVertex(VertInf *vertex, ConnEnd& connEnd) 
                 const;
         std::pair<Obstacle *, Obstacle *> endpointAnchors(void) const;
@@ -341,6 +344,8 @@ class ConnRef
         bool m_active:1;
         bool m_initialised:1;
         bool m_hate_crossings:1;
+        bool m_search_region_valid:1;
+        bool m_endpoint_moved:1;
         PolyLine m_route;
         Polygon m_display_route;
         double m_route_dist;
@@ -354,6 +359,11 @@ class ConnRef
         ConnEnd *m_dst_connend;
         std::vector<Point> m_checkpoints;
         std::vector<VertInf *> m_checkpoint_vertices;
+        // Bounding box of the visibility graph vertices examined by the 
+        // searches that found m_route, and the router's route cache epoch
+        // at that time.
+        BBox m_search_region;
+        unsigned int m_search_region_epoch;
 };
 
 
@@ -331,8 +331,8 @@ void ConnEnd::assignPinVisibilityTo(VertInf *dummyConnectionVert,
             {
                 // This has same ID and is either unconnected or not 
                 // exclusive, so give it visibility.
-                EdgeInf *edge = new EdgeInf(dummyConnectionVert,
-                        currPin->m_vertex, true);
+                EdgeInf *edge = new (router, true) EdgeInf(
+                        dummyConnectionVert, currPin->m_vertex, true);
                 // XXX Can't use a zero cost due to assumptions 
                 //     elsewhere in code.
                 edge->setDist(manhattanDist(dummyConnectionVert->point,
@@ -344,7 +344,7 @@ void ConnEnd::assignPinVisibilityTo(VertInf *dummyConnectionVert,
             {
                 // This has same ID and is either unconnected or not 
                 // exclusive, so give it visibility.
-                EdgeInf *edge = new EdgeInf(dummyConnectionVert,
+                EdgeInf *edge = new (router) EdgeInf(dummyConnectionVert,
                         currPin->m_vertex, false);
                 // XXX Can't use a zero cost due to assumptions 
                 //     elsewhere in code.
@@ -23,7 +23,9 @@
 */
 
 
+#include <new>
 #include <cmath>
+#include <algorithm>
 
 #include "libavoid/debug.h"
 #include "libavoid/graph.h"
@@ -32,6 +34,7 @@
 #include "libavoid/timer.h"
 #include "libavoid/vertices.h"
 #include "libavoid/router.h"
+#include "libavoid/blockpool.h"
 #include "libavoid/assertions.h"
 
 
@@ -43,23 +46,25 @@ namespace Avoid {
 EdgeInf::EdgeInf(VertInf *v1, VertInf *v2, const bool orthogonal)
     : lstPrev(NULL),
       lstNext(NULL),
-      m_router(NULL),
-      m_blocker(0),
-      m_added(false),
-      m_visible(false),
-      m_orthogonal(orthogonal),
       m_vert1(v1),
       m_vert2(v2),
-      m_dist(-1)
+      m_poly_line(NULL),
+      m_dist(-1),
+      m_added(false),
+      m_visible(false),
+      m_orthogonal(orthogonal)
 {
     // Not passed NULL values.
     COLA_ASSERT(v1 && v2);
 
     // We are in the same instance
     COLA_ASSERT(m_vert1->_router == m_vert2->_router);
-    m_router = m_vert1->_router;
 
-    m_conns.clear();
+    if (!m_orthogonal)
+    {
+        m_poly_line = new (router()->m_poly_line_state_pool->allocate())
+                PolyLineState();
+    }
 }
 
 
@@ -69,6 +74,41 @@ EdgeInf::~EdgeInf()
     {
         makeInactive();
     }
+    if (m_poly_line)
+    {
+        m_poly_line->~PolyLineState();
+        BlockPool::free(m_poly_line);
+    }
+}
+
+
+void *EdgeInf::operator new(size_t size, Router *router, 
+        const bool orthogonal)
+{
+    COLA_ASSERT(size == sizeof(EdgeInf));
+    if (orthogonal)
+    {
+        return router->m_orthogonal_edge_arena->allocate();
+    }
+    return router->m_edge_pool->allocate();
+}
+
+
+void EdgeInf::operator delete(void *ptr, Router *, const bool)
+{
+    BlockPool::free(ptr);
+}
+
+
+void EdgeInf::operator delete(void *ptr)
+{
+    BlockPool::free(ptr);
+}
+
+
+Router *EdgeInf::router(void) const
+{
+    return m_vert1->_router;
 }
 
 
@@ -184,31 +224,41 @@ void EdgeInf::makeActive(void)
 {
     COLA_ASSERT(m_added == false);
 
+    router()->timers.Count(ctEdgesAdded);
     if (m_orthogonal)
     {
         COLA_ASSERT(m_visible);
-        m_router->visOrthogGraph.addEdge(this);
-        m_pos1 = m_vert1->orthogVisList.insert(m_vert1->orthogVisList.begin(), this);
+        if (!isDummyConnection())
+        {
+            // The static graph has changed.
+            router()->m_astar_landmarks.invalidate();
+        }
+        router()->visOrthogGraph.addEdge(this);
+        m_vert1->orthogVisList.insert(m_vert1->orthogVisList.begin(), this);
         m_vert1->orthogVisListSize++;
-        m_pos2 = m_vert2->orthogVisList.insert(m_vert2->orthogVisList.begin(), this);
+        m_vert2->orthogVisList.insert(m_vert2->orthogVisList.begin(), this);
         m_vert2->orthogVisListSize++;
     }
     else
     {
         if (m_visible)
         {
-            m_router->visGraph.addEdge(this);
-            m_pos1 = m_vert1->visList.insert(m_vert1->visList.begin(), this);
+            router()->visGraph.addEdge(this);
+            m_poly_line->pos1 =
+                    m_vert1->visList.insert(m_vert1->visList.begin(), this);
             m_vert1->visListSize++;
-            m_pos2 = m_vert2->visList.insert(m_vert2->visList.begin(), this);
+            m_poly_line->pos2 =
+                    m_vert2->visList.insert(m_vert2->visList.begin(), this);
             m_vert2->visListSize++;
         }
         else // if (invisible)
         {
-            m_router->invisGraph.addEdge(this);
-            m_pos1 = m_vert1->invisList.insert(m_vert1->invisList.begin(), this);
+            router()->invisGraph.addEdge(this);
+            m_poly_line->pos1 =
+                    m_vert1->invisList.insert(m_vert1->invisList.begin(), this);
             m_vert1->invisListSize++;
-            m_pos2 = m_vert2->invisList.insert(m_vert2->invisList.begin(), this);
+            m_poly_line->pos2 =
+                    m_vert2->invisList.insert(m_vert2->invisList.begin(), this);
             m_vert2->invisListSize++;
         }
     }
@@ -223,33 +273,45 @@ void EdgeInf::makeInactive(void)
     if (m_orthogonal)
     {
         COLA_ASSERT(m_visible);
-        m_router->visOrthogGraph.removeEdge(this);
-        m_vert1->orthogVisList.erase(m_pos1);
+        if (!isDummyConnection())
+        {
+            // The static graph has changed.
+            router()->m_astar_landmarks.invalidate();
+        }
+        router()->visOrthogGraph.removeEdge(this);
+        // Erasing keeps the order of the remaining edges.
+        m_vert1->orthogVisList.erase(std::find(m_vert1->orthogVisList.begin(),
+                m_vert1->orthogVisList.end(), this));
         m_vert1->orthogVisListSize--;
-        m_vert2->orthogVisList.erase(m_pos2);
+        m_vert2->orthogVisList.erase(std::find(m_vert2->orthogVisList.begin(),
+                m_vert2->orthogVisList.end(), this));
         m_vert2->orthogVisListSize--;
     }
     else
     {
         if (m_visible)
         {
-            m_router->visGraph.removeEdge(this);
-            m_vert1->visList.erase(m_pos1);
+            router()->visGraph.removeEdge(this);
+            m_vert1->visList.erase(m_poly_line->pos1);
             m_vert1->visListSize--;
-            m_vert2->visList.erase(m_pos2);
+            m_vert2->visList.erase(m_poly_line->pos2);
             m_vert2->visListSize--;
         }
         else // if (invisible)
         {
-            m_router->invisGraph.removeEdge(this);
-            m_vert1->invisList.erase(m_pos1);
+            router()->invisGraph.removeEdge(this);
+            m_vert1->invisList.erase(m_poly_line->pos1);
             m_vert1->invisListSize--;
-            m_vert2->invisList.erase(m_pos2);
+            m_vert2->invisList.erase(m_poly_line->pos2);
             m_vert2->invisListSize--;
         }
     }
-    m_blocker = 0;
-    m_conns.clear();
+    if (m_poly_line)
+    {
+        m_poly_line->blocker = 0;
+        delete m_poly_line->conns;
+        m_poly_line->conns = NULL;
+    }
     m_added = false;
 }
 
@@ -269,34 +331,12 @@ void EdgeInf::setDist(double dist)
         makeActive();
     }
     m_dist = dist;
-    m_blocker = 0;
-}
-
-
-void EdgeInf::setMtstDist(VertInf *from, const double bendCost)
-{
-    VertInf *other = otherVert(from);
-
-    // The default cost is the cost back to the root of each forest plus the
-    // length of this edge.
-    double cost = m_vert1->sptfDist + m_vert2->sptfDist + getDist();
-
-    // If the other end is connecting to a forest via a bend, then add a
-    // penalty for it.  Note, the penalty is already added for the side
-    // we are connecting from.
-    if (other->pathNext && ! colinear(other->pathNext->point,
-            other->point, from->point))
+    if (m_poly_line)
     {
-        cost += bendCost;
+        m_poly_line->blocker = 0;
     }
-
-    m_mtst_dist = cost;
 }
 
-double EdgeInf::mtstDist(void) const
-{
-    return m_mtst_dist;
-}
 
 bool EdgeInf::added(void)
 {
@@ -306,24 +346,36 @@ bool EdgeInf::added(void)
 
 int EdgeInf::blocker(void) const
 {
-    return m_blocker;
+    return (m_poly_line) ? m_poly_line->blocker : 0;
 }
 
 
 void EdgeInf::alertConns(void)
 {
-    FlagList::iterator finish = m_conns.end();
-    for (FlagList::iterator i = m_conns.begin(); i != finish; ++i)
+    if ((m_poly_line == NULL) || (m_poly_line->conns == NULL))
+    {
+        // No connectors have been routed over this edge.  Orthogonal edges
+        // never record them.
+        return;
+    }
+    FlagList& conns = *(m_poly_line->conns);
+    FlagList::iterator finish = conns.end();
+    for (FlagList::iterator i = conns.begin(); i != finish; ++i)
     {
         *(*i) = true;
     }
-    m_conns.clear();
+    conns.clear();
 }
 
 
 void EdgeInf::addConn(bool *flag)
 {
-    m_conns.push_back(flag);
+    COLA_ASSERT(m_poly_line);
+    if (m_poly_line->conns == NULL)
+    {
+        m_poly_line->conns = new FlagList();
+    }
+    m_poly_line->conns->push_back(flag);
 }
 
 
@@ -336,7 +388,7 @@ void EdgeInf::addCycleBlocker(void)
 
 void EdgeInf::addBlocker(int b)
 {
-    COLA_ASSERT(m_router->InvisibilityGrph);
+    COLA_ASSERT(router()->InvisibilityGrph);
 
     if (m_added && m_visible)
     {
@@ -349,7 +401,7 @@ void EdgeInf::addBlocker(int b)
         makeActive();
     }
     m_dist = 0;
-    m_blocker = b;
+    m_poly_line->blocker = b;
 }
 
 
@@ -401,19 +453,20 @@ void EdgeInf::checkVis(void)
     const Point& iPoint = i->point;
     const Point& jPoint = j->point;
 
-    m_router->st_checked_edges++;
+    router()->st_checked_edges++;
+    router()->timers.Count(ctVisibilityChecks);
 
     if (!(iID.isConnPt()))
     {
-        cone1 = inValidRegion(m_router->IgnoreRegions, i->shPrev->point,
+        cone1 = inValidRegion(router()->IgnoreRegions, i->shPrev->point,
                 iPoint, i->shNext->point, jPoint);
     }
-    else if (m_router->IgnoreRegions == false)
+    else if (router()->IgnoreRegions == false)
     {
         // If Ignoring regions then this case is already caught by 
         // the invalid regions, so only check it when not ignoring
         // regions.
-        ShapeSet& ss = m_router->contains[iID];
+        ShapeSet& ss = router()->contains[iID];
 
         if (!(jID.isConnPt()) && (ss.find(jID.objID) != ss.end()))
         {
@@ -429,15 +482,15 @@ void EdgeInf::checkVis(void)
         // If outside the first cone, don't even bother checking.
         if (!(jID.isConnPt()))
         {
-            cone2 = inValidRegion(m_router->IgnoreRegions, j->shPrev->point,
+            cone2 = inValidRegion(router()->IgnoreRegions, j->shPrev->point,
                     jPoint, j->shNext->point, iPoint);
         }
-        else if (m_router->IgnoreRegions == false)
+        else if (router()->IgnoreRegions == false)
         {
             // If Ignoring regions then this case is already caught by 
             // the invalid regions, so only check it when not ignoring
             // regions.
-            ShapeSet& ss = m_router->contains[jID];
+            ShapeSet& ss = router()->contains[jID];
 
             if (!(iID.isConnPt()) && (ss.find(iID.objID) != ss.end()))
             {
@@ -461,7 +514,7 @@ void EdgeInf::checkVis(void)
         setDist(d);
 
     }
-    else if (m_router->InvisibilityGrph)
+    else if (router()->InvisibilityGrph)
     {
 #if 0
         db_printf("%d, %d, %d\n", cone1, cone2, blocker);
@@ -487,7 +540,7 @@ int EdgeInf::firstBlocker(void)
     VertID& iID = m_vert1->id;
     VertID& jID = m_vert2->id;
 
-    ContainsMap &contains = m_router->contains;
+    ContainsMap &contains = router()->contains;
     if (iID.isConnPt())
     {
         ss.insert(contains[iID].begin(), contains[iID].end());
@@ -497,10 +550,10 @@ int EdgeInf::firstBlocker(void)
         ss.insert(contains[jID].begin(), contains[jID].end());
     }
 
-    VertInf *last = m_router->vertices.end();
+    VertInf *last = router()->vertices.end();
     unsigned int lastId = 0;
     bool seenIntersectionAtEndpoint = false;
-    for (VertInf *k = m_router->vertices.shapesBegin(); k != last; )
+    for (VertInf *k = router()->vertices.shapesBegin(); k != last; )
     {
         VertID kID = k->id;
         if (k->id == dummyOrthogID)
@@ -591,14 +644,14 @@ EdgeInf *EdgeInf::checkEdgeVisibility(VertInf *i, VertInf *j, bool knownNew)
     if (knownNew)
     {
         COLA_ASSERT(existingEdge(i, j) == NULL);
-        edge = new EdgeInf(i, j);
+        edge = new (i->_router) EdgeInf(i, j);
     }
     else
     {
         edge = existingEdge(i, j);
         if (edge == NULL)
         {
-            edge = new EdgeInf(i, j);
+            edge = new (i->_router) EdgeInf(i, j);
         }
     }
     edge->checkVis();
@@ -633,10 +686,9 @@ EdgeInf *EdgeInf::existingEdge(VertInf *i, VertInf *j)
 
     // Look through orthogonal visibility edges.
     selected = (i->orthogVisListSize <= j->orthogVisListSize) ? i : j;
-    EdgeInfList& orthogVisList = selected->orthogVisList;
-    finish = orthogVisList.end();
-    for (EdgeInfList::const_iterator edge = orthogVisList.begin(); 
-            edge != finish; ++edge)
+    EdgeInfVector& orthogVisList = selected->orthogVisList;
+    for (EdgeInfVector::const_iterator edge = orthogVisList.begin(); 
+            edge != orthogVisList.end(); ++edge)
     {
         if ((*edge)->isBetween(i, j))
         {
@@ -690,6 +742,14 @@ void EdgeList::clear(void)
 }
 
 
+void EdgeList::forgetEdges(void)
+{
+    m_first_edge = NULL;
+    m_last_edge = NULL;
+    m_count = 0;
+}
+
+
 int EdgeList::size(void) const
 {
     return m_count;
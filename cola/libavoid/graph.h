@@ -43,11 +43,21 @@ typedef std::list<int> ShapeList;
 typedef std::list<bool *> FlagList;
 
 
+// Edges are allocated from their router's pools, i.e., created with
+// new (router) EdgeInf(v1, v2) for poly-line edges and with
+// new (router, true) EdgeInf(v1, v2, true) for orthogonal edges.  The
+// latter come from the orthogonal graph arena and are all reclaimed by
+// Router::destroyOrthogonalVisGraph().
 class EdgeInf
 {
     public:
         EdgeInf(VertInf *v1, VertInf *v2, const bool orthogonal = false);
         ~EdgeInf();
+        static void *operator new(size_t size, Router *router, 
+                const bool orthogonal = false);
+        static void operator delete(void *ptr, Router *router, 
+                const bool orthogonal);
+        static void operator delete(void *ptr);
         inline double getDist(void)
         {
             return m_dist;
@@ -70,31 +80,47 @@ class EdgeInf
                 bool knownNew = false);
         static EdgeInf *existingEdge(VertInf *i, VertInf *j);
         int blocker(void) const;
-        double mtstDist(void) const;
-        void setMtstDist(VertInf *from, const double bendCost);
 
         EdgeInf *lstPrev;
         EdgeInf *lstNext;
     private:
         friend class MinimumTerminalSpanningTree;
+        friend class Router;
+
+        // State only needed by poly-line (in)visibility edges.  Orthogonal
+        // edges are far more numerous and are kept compact without it.
+        // This is allocated from the router's poly-line state pool, and
+        // the list of connectors is only created once one is added.
+        struct PolyLineState
+        {
+            PolyLineState()
+                : conns(NULL),
+                  blocker(0)
+            {
+            }
+            ~PolyLineState()
+            {
+                delete conns;
+            }
+            EdgeInfList::iterator pos1;
+            EdgeInfList::iterator pos2;
+            FlagList *conns;
+            int blocker;
+        };
 
         void makeActive(void);
         void makeInactive(void);
         int firstBlocker(void);
         bool isBetween(VertInf *i, VertInf *j);
+        Router *router(void) const;
 
-        Router *m_router;
-        int m_blocker;
-        bool m_added;
-        bool m_visible;
-        bool m_orthogonal;
         VertInf *m_vert1;
         VertInf *m_vert2;
-        EdgeInfList::iterator m_pos1;
-        EdgeInfList::iterator m_pos2;
-        FlagList  m_conns;
+        PolyLineState *m_poly_line;
         double  m_dist;
-        double  m_mtst_dist;
+        bool m_added:1;
+        bool m_visible:1;
+        bool m_orthogonal:1;
 };
 
 
@@ -105,6 +131,9 @@ class EdgeList
         EdgeList(bool orthogonal = false);
         ~EdgeList();
         void clear(void);
+        // Empties the list without deleting or detaching its edges, for 
+        // when their storage is reclaimed in bulk.
+        void forgetEdges(void);
         EdgeInf *begin(void);
         EdgeInf *end(void);
         int size(void) const;
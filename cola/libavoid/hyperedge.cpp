@@ -272,47 +272,64 @@ void HyperedgeRerouter::performRerouting(void)
     m_new_connectors_vector.clear();
     m_new_connectors_vector.resize(count());
 
-    // For each hyperedge...
+    // Execute the MTST method for each hyperedge to find good junction 
+    // positions and an initial path.  A hyperedge tree will be built for 
+    // each new route.
     const size_t num_hyperedges = count();
-    for (size_t i = 0; i < num_hyperedges; ++i)
+    std::vector<JunctionHyperEdgeTreeNodeMap> hyperEdgeTreeJunctions(
+            num_hyperedges);
+    if (m_router->routingOption(computeHyperedgeTreesConcurrently))
     {
-        // Execute the MTST method to find good junction positions and an
-        // initial path.  A hyperedge tree will be build for the new route.
-        JunctionHyperEdgeTreeNodeMap hyperEdgeTreeJunctions;
-        MinimumTerminalSpanningTree mtst(m_router, m_terminal_vertices_vector[i],
-                &hyperEdgeTreeJunctions);
-        mtst.execute();
-
-        HyperEdgeTreeNode *treeRoot = mtst.rootJunction();
-        COLA_ASSERT(treeRoot);
-        
-        // Fill in connector information and join them to junctions of endpoints
-        // of original connectors.
-        treeRoot->addConns(NULL, m_router, 
-                m_deleted_connectors_vector[i], NULL);
-
-        // Output the list of new junctions and connectors from hyperedge tree.
-        treeRoot->listJunctionsAndConnectors(NULL, m_new_junctions_vector[i],
-                m_new_connectors_vector[i]);
-
-        // Write paths from the hyperedge tree back into individual
-        // connector routes.
-        for (size_t pass = 0; pass < 2; ++pass)
+        // All the trees are built, from the same visibility graph, before 
+        // the router is modified.  So unlike the serial case below, a 
+        // hyperedge's tree doesn't see the changes made in replacing the 
+        // hyperedges before it.
+        std::vector<MinimumTerminalSpanningTree *> mtsts(num_hyperedges);
+        const int num = (int) num_hyperedges;
+        m_router->timers.Register(tmHyperedgeForest, timerStart);
+#ifdef _OPENMP
+        #pragma omp parallel
+#endif
         {
-            treeRoot->writeEdgesToConns(NULL, pass);
+            // Each thread needs its own per-vertex search state.
+            MTSTWorkspace workspace;
+#ifdef _OPENMP
+            #pragma omp for schedule(dynamic)
+#endif
+            for (int i = 0; i < num; ++i)
+            {
+                mtsts[i] = new MinimumTerminalSpanningTree(m_router, 
+                        m_terminal_vertices_vector[i], 
+                        &hyperEdgeTreeJunctions[i], &workspace);
+                mtsts[i]->constructTree();
+                // The workspace goes away with this thread.
+                mtsts[i]->releaseWorkspace();
+            }
         }
+        m_router->timers.Stop();
 
-        // Tell the router that we are deleting the objects used for the
-        // previous path for the hyperedge.
-        for (ConnRefList::iterator curr = m_deleted_connectors_vector[i].begin();
-                curr != m_deleted_connectors_vector[i].end(); ++curr)
+        // Create the junctions and connectors one hyperedge at a time, in 
+        // order, so the result doesn't depend on how the trees were built.
+        for (size_t i = 0; i < num_hyperedges; ++i)
         {
-            m_router->deleteConnector(*curr);
+            mtsts[i]->createJunctions();
+            replaceHyperedge(i, mtsts[i]->rootJunction());
+            delete mtsts[i];
         }
-        for (JunctionRefList::iterator curr = m_deleted_junctions_vector[i].begin();
-                curr != m_deleted_junctions_vector[i].end(); ++curr)
+    }
+    else
+    {
+        // The per-vertex search state is shared by all the MTSTs, so each 
+        // only needs to initialise the vertices it reaches.
+        MTSTWorkspace workspace;
+        for (size_t i = 0; i < num_hyperedges; ++i)
         {
-            m_router->deleteJunction(*curr);
+            MinimumTerminalSpanningTree mtst(m_router, 
+                    m_terminal_vertices_vector[i], 
+                    &hyperEdgeTreeJunctions[i], &workspace);
+            mtst.execute();
+            mtst.createJunctions();
+            replaceHyperedge(i, mtst.rootJunction());
         }
     }
 
@@ -333,5 +350,45 @@ void HyperedgeRerouter::performRerouting(void)
 }
 
 
+// Replaces the objects forming the old route of a hyperedge with new 
+// junctions and connectors for the given hyperedge tree.
+void HyperedgeRerouter::replaceHyperedge(size_t index, 
+        HyperEdgeTreeNode *treeRoot)
+{
+    COLA_ASSERT(treeRoot);
+    
+    // Fill in connector information and join them to junctions of endpoints
+    // of original connectors.
+    treeRoot->addConns(NULL, m_router, 
+            m_deleted_connectors_vector[index], NULL);
+
+    // Output the list of new junctions and connectors from hyperedge tree.
+    treeRoot->listJunctionsAndConnectors(NULL, m_new_junctions_vector[index],
+            m_new_connectors_vector[index]);
+
+    // Write paths from the hyperedge tree back into individual
+    // connector routes.
+    for (size_t pass = 0; pass < 2; ++pass)
+    {
+        treeRoot->writeEdgesToConns(NULL, pass);
+    }
+
+    // Tell the router that we are deleting the objects used for the
+    // previous path for the hyperedge.
+    for (ConnRefList::iterator curr = 
+            m_deleted_connectors_vector[index].begin();
+            curr != m_deleted_connectors_vector[index].end(); ++curr)
+    {
+        m_router->deleteConnector(*curr);
+    }
+    for (JunctionRefList::iterator curr = 
+            m_deleted_junctions_vector[index].begin();
+            curr != m_deleted_junctions_vector[index].end(); ++curr)
+    {
+        m_router->deleteJunction(*curr);
+    }
+}
+
+
 }
     
@@ -40,6 +40,7 @@ class JunctionRef;
 class Router;
 class ConnEnd;
 class VertInf;
+struct HyperEdgeTreeNode;
 
 typedef std::list<ConnEnd> ConnEndList;
 typedef std::list<ConnRef *> ConnRefList;
@@ -187,6 +188,7 @@ class HyperedgeRerouter
         ConnRefSet calcHyperedgeConnectors(void);
         // Called by Router during processTransaction().
         void performRerouting(void);
+        void replaceHyperedge(size_t index, HyperEdgeTreeNode *treeRoot);
         void outputInstanceToSVG(FILE *fp);
         void findAttachedObjects(size_t index, ConnRef *connector,
                 JunctionRef *ignore, ConnRefSet& hyperedgeConns);;
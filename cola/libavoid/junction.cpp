@@ -79,6 +79,7 @@ Rectangle JunctionRef::makeRectangle(Router *router, const Point& position)
 
 void JunctionRef::setPositionFixed(bool fixed)
 {
+    m_router->waitForAsyncTransactions();
     m_position_fixed = fixed;
 }
 
@@ -91,6 +92,7 @@ bool JunctionRef::positionFixed(void) const
 
 void JunctionRef::preferOrthogonalDimension(const size_t dim)
 {
+    m_router->waitForAsyncTransactions();
     const double smallPenalty = 1.0;
     for (ShapeConnectionPinSet::iterator curr = 
             m_connection_pins.begin(); curr != m_connection_pins.end(); ++curr)
@@ -25,7 +25,10 @@
 
 #include <algorithm>
 #include <vector>
+#include <queue>
+#include <functional>
 #include <climits>
+#include <cfloat>
 
 // For M_PI:
 #define _USE_MATH_DEFINES
@@ -37,6 +40,7 @@
 #include "libavoid/viscluster.h"
 #include "libavoid/graph.h"
 #include "libavoid/router.h"
+#include "libavoid/makepath.h"
 #include "libavoid/debug.h"
 #include "libavoid/assertions.h"
 #ifdef ASTAR_DEBUG
@@ -45,39 +49,6 @@
 
 namespace Avoid {
 
-class ANode
-{
-    public:
-        VertInf* inf;
-        double g;        // Gone
-        double h;        // Heuristic
-        double f;        // Formula f = g + h
-        
-        int prevIndex;   // Index into DONE for the previous ANode.
-        int timeStamp;   // Time-stamp used to determine exploration order of
-                         // seemingly equal paths during orthogonal routing.
-
-        ANode(VertInf *vinf, int time)
-            : inf(vinf),
-              g(0),
-              h(0),
-              f(0),
-              prevIndex(-1),
-              timeStamp(time)
-        {
-        }
-        ANode()
-            : inf(NULL),
-              g(0),
-              h(0),
-              f(0),
-              prevIndex(-1),
-              timeStamp(-1)
-        {
-        }
-};
-
-
 // This returns the opposite result (>) so that when used with stl::make_heap, 
 // the head node of the heap will be the smallest value, rather than the 
 // largest.  This saves us from having to sort the heap (and then reorder
@@ -104,6 +75,9 @@ bool operator<(const ANode &a, const ANode &b)
 }
 
 
+const double ANodeQueue::fQuantum = 1024;
+
+
 static double Dot(const Point& l, const Point& r)
 {
     return (l.x * r.x) + (l.y * r.y);
@@ -137,13 +111,13 @@ static double angleBetween(const Point& p1, const Point& p2, const Point& p3)
 // Construct a temporary Polygon path given several VertInf's for a connector.
 //
 static void constructPolygonPath(Polygon& connRoute, VertInf *inf2, 
-        VertInf *inf3, std::vector<ANode>& done, int inf1Index)
+        VertInf *inf3, const AStarNodePool& pool, int inf1Index)
 {
     // Don't include colinear points.
     bool simplified = true;
 
     int routeSize = 2;
-    for (int curr = inf1Index; curr >= 0; curr = done[curr].prevIndex)
+    for (int curr = inf1Index; curr >= 0; curr = pool.doneNode(curr).prevIndex)
     {
         routeSize += 1;
     }
@@ -152,19 +126,20 @@ static void constructPolygonPath(Polygon& connRoute, VertInf *inf2,
     connRoute.ps[routeSize - 1] = inf3->point;
     connRoute.ps[routeSize - 2] = inf2->point;
     routeSize -= 3;
-    for (int curr = inf1Index; curr >= 0; curr = done[curr].prevIndex)
+    for (int curr = inf1Index; curr >= 0; curr = pool.doneNode(curr).prevIndex)
     {
         if (!simplified)
         {
             // Add new point.
-            connRoute.ps[routeSize] = done[curr].inf->point;
+            connRoute.ps[routeSize] = pool.doneNode(curr).inf->point;
             routeSize -= 1;
             continue;
         }
             
         
         if ((curr == inf1Index) || 
-                vecDir(done[curr].inf->point, connRoute.ps[routeSize + 1], 
+                vecDir(pool.doneNode(curr).inf->point, 
+                    connRoute.ps[routeSize + 1], 
                     connRoute.ps[routeSize + 2]) != 0)
         {
             // Add new point if this is the earlier than the last segment
@@ -172,13 +147,13 @@ static void constructPolygonPath(Polygon& connRoute, VertInf *inf2,
             // Note, you can't collapse the 'last' segment with previous 
             // segments, or if this just intersects another line you risk 
             // penalising it once for each collapsed line segment.
-            connRoute.ps[routeSize] = done[curr].inf->point;
+            connRoute.ps[routeSize] = pool.doneNode(curr).inf->point;
             routeSize -= 1;
         }
         else
         {
             // The last point is inline with this one, so update it.
-            connRoute.ps[routeSize + 1] = done[curr].inf->point;
+            connRoute.ps[routeSize + 1] = pool.doneNode(curr).inf->point;
         }
     }
 
@@ -203,9 +178,9 @@ static void constructPolygonPath(Polygon& connRoute, VertInf *inf2,
 // cost associated with this route.
 //
 static double cost(ConnRef *lineRef, const double dist, VertInf *inf2, 
-        VertInf *inf3, std::vector<ANode>& done, int inf1Index)
+        VertInf *inf3, const AStarNodePool& pool, int inf1Index)
 {
-    VertInf *inf1 = (inf1Index >= 0) ?  done[inf1Index].inf : NULL;
+    VertInf *inf1 = (inf1Index >= 0) ?  pool.doneNode(inf1Index).inf : NULL;
     double result = dist;
     Polygon connRoute;
 
@@ -259,7 +234,7 @@ static double cost(ConnRef *lineRef, const double dist, VertInf *inf2,
     {
         if (connRoute.empty())
         {
-            constructPolygonPath(connRoute, inf2, inf3, done, inf1Index);
+            constructPolygonPath(connRoute, inf2, inf3, pool, inf1Index);
         }
         // There are clusters so do cluster routing.
         for (ClusterRefList::const_iterator cl = router->clusterRefs.begin(); 
@@ -305,7 +280,7 @@ static double cost(ConnRef *lineRef, const double dist, VertInf *inf2,
     {
         if (connRoute.empty())
         {
-            constructPolygonPath(connRoute, inf2, inf3, done, inf1Index);
+            constructPolygonPath(connRoute, inf2, inf3, pool, inf1Index);
         }
         ConnRefList::const_iterator curr, finish = router->connRefs.end();
         for (curr = router->connRefs.begin(); curr != finish; ++curr)
@@ -345,8 +320,12 @@ static double cost(ConnRef *lineRef, const double dist, VertInf *inf2,
 }
 
 
+// Estimates the cost of the path from a to b.  The lower bound on the 
+// remaining path length (landmarkDist) given by the A* landmarks, if any,
+// is used when it is tighter than the straight-line distance.
+//
 static double estimatedCost(ConnRef *lineRef, const Point *last, 
-        const Point& a, const Point& b)
+        const Point& a, const Point& b, const double landmarkDist = 0)
 {
     if (lineRef->routingType() == ConnType_PolyLine)
     {
@@ -388,11 +367,256 @@ static double estimatedCost(ConnRef *lineRef, const Point *last,
         double penalty = num_penalties * 
                 lineRef->router()->routingParameter(segmentPenalty);
 
-        return manhattanDist(a, b) + penalty;
+        return std::max(manhattanDist(a, b), landmarkDist) + penalty;
     }
 }
 
 
+AStarLandmarks::AStarLandmarks()
+    : m_valid(false)
+{
+}
+
+
+void AStarLandmarks::invalidate(void)
+{
+    m_valid = false;
+}
+
+
+bool AStarLandmarks::isValid(void) const
+{
+    return m_valid;
+}
+
+
+size_t AStarLandmarks::size(void) const
+{
+    return m_landmarks.size();
+}
+
+
+bool AStarLandmarks::knowsVertex(const VertInf *vert) const
+{
+    const unsigned int index = vert->landmarkIndex;
+    return (index < m_vertices.size()) && (m_vertices[index] == vert);
+}
+
+
+double AStarLandmarks::distance(const size_t landmark, 
+        const VertInf *vert) const
+{
+    COLA_ASSERT(m_valid);
+    COLA_ASSERT(knowsVertex(vert));
+    return m_distances[(landmark * m_vertices.size()) + vert->landmarkIndex];
+}
+
+
+// Runs Dijkstra's algorithm over the orthogonal visibility graph from the
+// vertex with the given index.  Unreachable vertices are given a distance
+// of -1.  Dummy edges to connection pins are ignored, since these are only
+// present while the connector using them is being routed.
+//
+void AStarLandmarks::shortestPathsFrom(const size_t sourceIndex, 
+        std::vector<double>& dists) const
+{
+    typedef std::pair<double, unsigned int> DistIndexPair;
+    std::priority_queue<DistIndexPair, std::vector<DistIndexPair>,
+            std::greater<DistIndexPair> > pending;
+
+    dists.assign(m_vertices.size(), -1);
+    dists[sourceIndex] = 0;
+    pending.push(DistIndexPair(0, sourceIndex));
+    while (!pending.empty())
+    {
+        DistIndexPair curr = pending.top();
+        pending.pop();
+        if (curr.first > dists[curr.second])
+        {
+            // Stale entry.
+            continue;
+        }
+        VertInf *vert = m_vertices[curr.second];
+        EdgeInfVector::const_iterator finish = vert->orthogVisList.end();
+        for (EdgeInfVector::const_iterator edge = vert->orthogVisList.begin();
+                edge != finish; ++edge)
+        {
+            if ((*edge)->isDummyConnection())
+            {
+                continue;
+            }
+            VertInf *other = (*edge)->otherVert(vert);
+            if (!knowsVertex(other))
+            {
+                continue;
+            }
+            double newDist = curr.first + (*edge)->getDist();
+            double& otherDist = dists[other->landmarkIndex];
+            if ((otherDist < 0) || (newDist < otherDist))
+            {
+                otherDist = newDist;
+                pending.push(DistIndexPair(newDist, other->landmarkIndex));
+            }
+        }
+    }
+}
+
+
+// Chooses landmarks by farthest point selection, starting from the vertex
+// farthest from an arbitrary vertex in the graph and then repeatedly adding
+// the vertex farthest from all existing landmarks.  Only the component of 
+// the graph containing the first vertex with visibility is covered.
+//
+void AStarLandmarks::compute(Router *router, const size_t landmarkCount)
+{
+    m_valid = false;
+    m_vertices.clear();
+    m_landmarks.clear();
+    m_distances.clear();
+
+    size_t seedIndex = UINT_MAX;
+    VertInf *finish = router->vertices.end();
+    for (VertInf *k = router->vertices.connsBegin(); k != finish; 
+            k = k->lstNext)
+    {
+        if ((seedIndex == UINT_MAX) && (k->orthogVisListSize > 0))
+        {
+            seedIndex = m_vertices.size();
+        }
+        k->landmarkIndex = m_vertices.size();
+        m_vertices.push_back(k);
+    }
+    if ((seedIndex == UINT_MAX) || (landmarkCount == 0))
+    {
+        return;
+    }
+    
+    const size_t n = m_vertices.size();
+    std::vector<double> dists;
+    shortestPathsFrom(seedIndex, dists);
+    
+    // The distance from each vertex to its nearest landmark, or to the 
+    // seed vertex before any landmarks are chosen.
+    std::vector<double> nearestDists = dists;
+    while (m_landmarks.size() < landmarkCount)
+    {
+        size_t farthest = 0;
+        for (size_t i = 1; i < n; ++i)
+        {
+            if (nearestDists[i] > nearestDists[farthest])
+            {
+                farthest = i;
+            }
+        }
+        if (nearestDists[farthest] <= 0)
+        {
+            // All reachable vertices are already landmarks.
+            break;
+        }
+        m_landmarks.push_back(m_vertices[farthest]);
+        shortestPathsFrom(farthest, dists);
+        m_distances.insert(m_distances.end(), dists.begin(), dists.end());
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (dists[i] >= 0)
+            {
+                nearestDists[i] = std::min(nearestDists[i], dists[i]);
+            }
+        }
+    }
+    m_valid = !m_landmarks.empty();
+}
+
+
+// A lower bound on the remaining path length from a vertex to the target
+// of a particular search, computed from the A* landmark distances using
+// the triangle inequality.  
+//
+// When the target vertex is not in the static orthogonal visibility graph,
+// i.e., it is the dummy vertex for a connection to a set of pins, the 
+// bound is computed via the pin vertices, plus the cost of the dummy edge 
+// from the pin to the target.
+//
+class LandmarkBound
+{
+    public:
+        LandmarkBound(const AStarLandmarks *landmarks, const VertInf *tar)
+            : m_landmarks(landmarks)
+        {
+            if (m_landmarks == NULL)
+            {
+                return;
+            }
+            if (m_landmarks->knowsVertex(tar) && 
+                    (m_landmarks->distance(0, tar) >= 0))
+            {
+                addTargetEntry(tar, 0);
+                return;
+            }
+            EdgeInfVector::const_iterator finish = tar->orthogVisList.end();
+            for (EdgeInfVector::const_iterator edge = 
+                    tar->orthogVisList.begin(); edge != finish; ++edge)
+            {
+                addTargetEntry((*edge)->otherVert(tar), (*edge)->getDist());
+            }
+        }
+        double lowerBound(const VertInf *vert) const
+        {
+            if (m_entry_costs.empty() || !m_landmarks->knowsVertex(vert))
+            {
+                return 0;
+            }
+            const size_t entries = m_entry_costs.size();
+            double bound = 0;
+            for (size_t l = 0; l < m_landmarks->size(); ++l)
+            {
+                const double vertDist = m_landmarks->distance(l, vert);
+                if (vertDist < 0)
+                {
+                    continue;
+                }
+                double landmarkBound = DBL_MAX;
+                for (size_t e = 0; e < entries; ++e)
+                {
+                    const double entryDist = m_entry_dists[(l * entries) + e];
+                    double entryBound = m_entry_costs[e];
+                    if (entryDist >= 0)
+                    {
+                        entryBound += fabs(entryDist - vertDist);
+                    }
+                    landmarkBound = std::min(landmarkBound, entryBound);
+                }
+                bound = std::max(bound, landmarkBound);
+            }
+            return bound;
+        }
+
+    private:
+        void addTargetEntry(const VertInf *vert, const double cost)
+        {
+            // Store the new entry's distances interleaved landmark-major 
+            // with the existing entries.
+            const size_t entries = m_entry_costs.size();
+            const bool known = m_landmarks->knowsVertex(vert);
+            std::vector<double> entryDists;
+            for (size_t l = 0; l < m_landmarks->size(); ++l)
+            {
+                entryDists.insert(entryDists.end(), 
+                        m_entry_dists.begin() + (l * entries),
+                        m_entry_dists.begin() + ((l + 1) * entries));
+                entryDists.push_back((known) ? 
+                        m_landmarks->distance(l, vert) : -1);
+            }
+            m_entry_dists.swap(entryDists);
+            m_entry_costs.push_back(cost);
+        }
+
+        const AStarLandmarks *m_landmarks;
+        std::vector<double> m_entry_dists;
+        std::vector<double> m_entry_costs;
+};
+
+
 class CmpVisEdgeRotation 
 {
     public:
@@ -415,6 +639,24 @@ class CmpVisEdgeRotation
 };
 
 
+// A stable sort for the handful of edges at an orthogonal vertex, which 
+// gives the same order as std::list::sort() without allocating.
+template <typename Compare>
+static void insertionSortEdges(EdgeInfVector& edges, Compare compare)
+{
+    for (size_t i = 1; i < edges.size(); ++i)
+    {
+        EdgeInf *edge = edges[i];
+        size_t j = i;
+        for (; (j > 0) && compare(edge, edges[j - 1]); --j)
+        {
+            edges[j] = edges[j - 1];
+        }
+        edges[j] = edge;
+    }
+}
+
+
 static inline bool pointAlignedWithOneOf(const Point& point, 
         const std::vector<Point>& points, const size_t dim)
 {
@@ -455,10 +697,31 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
         endPoints = lineRef->possibleDstPinPoints();
     }
     endPoints.push_back(tar->point);
+
+    Router *router = lineRef->router();
+
+    // Use the landmark distances as a tighter lower bound on path length
+    // if this has been requested and they are up to date.
+    const AStarLandmarks *landmarks = NULL;
+    if (isOrthogonal && router->m_astar_landmarks.isValid() &&
+            router->routingOption(useLandmarkHeuristicForOrthogonalRouting))
+    {
+        landmarks = &(router->m_astar_landmarks);
+    }
+    LandmarkBound landmarkBound(landmarks, tar);
+
+    // The orthogonal heuristic is consistent, so a radix heap can be used.
+    const bool useRadixHeap = isOrthogonal &&
+            router->routingOption(useRadixHeapForOrthogonalRouting);
     
-    std::vector<ANode> PENDING;     // STL Vectors chosen because of rapid
-    std::vector<ANode> DONE;        // insertions/deletions at back,
+    // The node storage is kept by the router and reused for every search.
+    AStarNodePool& pool = router->m_astar_node_pool;
+    pool.clear(useRadixHeap);
+    ANodeQueue& PENDING = pool.pending;
+    std::vector<unsigned int>& DONE = pool.done;
     size_t DONE_size = 0;
+    // The poly-line edges of the vertex being expanded.
+    EdgeInfVector polyLineEdges;
     ANode Node, BestNode;           // Temporary Node and BestNode
     bool bNodeFound = false;        // Flag if node is found in container
     int timestamp = 1;
@@ -468,7 +731,6 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
         start = src;
     }
 
-    Router *router = lineRef->router();
     if (router->RubberBandRouting && (start != src))
     {
         COLA_ASSERT(router->IgnoreRegions == true);
@@ -501,7 +763,7 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
                 double edgeDist = dist(BestNode.inf->point, curr->point);
 
                 Node.g = BestNode.g + cost(lineRef, edgeDist, BestNode.inf, 
-                        Node.inf, DONE, BestNode.prevIndex);
+                        Node.inf, pool, BestNode.prevIndex);
 
                 // Calculate the Heuristic.
                 Node.h = estimatedCost(lineRef, &(BestNode.inf->point),
@@ -518,13 +780,13 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
             {
                 BestNode = Node;
 
-                DONE.push_back(BestNode);
+                DONE.push_back(PENDING.store(BestNode));
                 BestNode.inf->aStarDoneIndexes.push_back(DONE_size);
                 DONE_size++;
             }
             else
             {
-                PENDING.push_back(Node);
+                Node.inf->aStarPendingIndexes.push_back(PENDING.push(Node));
             }
 
             rIndx++;
@@ -536,43 +798,33 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
         // Create the start node
         Node = ANode(src, timestamp++);
         Node.g = 0;
-        Node.h = estimatedCost(lineRef, NULL, Node.inf->point, tar->point);
+        Node.h = estimatedCost(lineRef, NULL, Node.inf->point, tar->point,
+                landmarkBound.lowerBound(Node.inf));
         Node.f = Node.g + Node.h;
         // Set a null parent, so cost function knows this is the first segment.
 
         // Populate the PENDING container with the first location
-        PENDING.push_back(Node);
+        Node.inf->aStarPendingIndexes.push_back(PENDING.push(Node));
     }
 
     tar->pathNext = NULL;
 
-    // Create a heap from PENDING for sorting
-    using std::make_heap; using std::push_heap; using std::pop_heap;
-    make_heap( PENDING.begin(), PENDING.end() );
-
     // Continue until the queue is empty.
     while (!PENDING.empty())
     {
-        // Set the Node with lowest f value to BESTNODE.
-        // Since the ANode operator< is reversed, the head of the
-        // heap is the node with the lowest f value.
-        BestNode = PENDING.front();
-
-        // Pop off the heap.  Actually this moves the
-        // far left value to the far right.  The node
-        // is not actually removed since the pop is to
-        // the heap and not the container.
-        pop_heap(PENDING.begin(), PENDING.end());
-        // Remove node from right (the value we pop_heap'd)
-        PENDING.pop_back();
+        // Set the Node with lowest f value to BESTNODE.  This is a copy, 
+        // since the pool may grow as its neighbours are added.
+        unsigned int bestHandle = PENDING.pop();
+        BestNode = PENDING.node(bestHandle);
 
         // Push the BestNode onto DONE
-        DONE.push_back(BestNode);
+        DONE.push_back(bestHandle);
         BestNode.inf->aStarDoneIndexes.push_back(DONE_size);
         DONE_size++;
+        router->timers.Count(ctAStarExpansions);
 
         VertInf *prevInf = (BestNode.prevIndex >= 0) ?
-                DONE[BestNode.prevIndex].inf : NULL;
+                pool.doneNode(BestNode.prevIndex).inf : NULL;
 #if 0
         db_printf("Considering... ");
         db_printf(" %g %g  ", BestNode.inf->point.x, BestNode.inf->point.y);
@@ -592,7 +844,7 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
             int radius = 5;
             ANode curr;
             for (curr = BestNode; curr.prevIndex >= 0; 
-                    curr = DONE[curr.prevIndex])
+                    curr = pool.doneNode(curr.prevIndex))
             {
                 filledCircleRGBA(router->avoid_screen, 
                         (int) curr.inf->point.x,
@@ -616,7 +868,7 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
                     (int) BestNode.inf->point.y,
                     radius, 0, 255, 0, 128);
             for (curr = BestNode; curr.prevIndex >= 0; 
-                    curr = DONE[curr.prevIndex])
+                    curr = pool.doneNode(curr.prevIndex))
             {
                 filledCircleRGBA(router->avoid_screen, 
                         (int) curr.inf->point.x,
@@ -642,32 +894,37 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
             ANode curr;
             int currIndex = DONE_size - 1;
             for (curr = BestNode; curr.prevIndex > 0; 
-                    curr = DONE[curr.prevIndex])
+                    curr = pool.doneNode(curr.prevIndex))
             {
-                curr.inf->pathNext = DONE[curr.prevIndex].inf;
+                curr.inf->pathNext = pool.doneNode(curr.prevIndex).inf;
                 currIndex = curr.prevIndex;
             }
             // Check that we've gone through the complete path.
             COLA_ASSERT(curr.prevIndex == 0);
             // Fill in the final pathNext pointer.
-            curr.inf->pathNext = DONE[curr.prevIndex].inf;
+            curr.inf->pathNext = pool.doneNode(curr.prevIndex).inf;
 
             // Exit from the search
             break;
         }
 
         // Check adjacent points in graph and add them to the queue.
-        EdgeInfList& visList = (!isOrthogonal) ?
-                BestNode.inf->visList : BestNode.inf->orthogVisList;
+        EdgeInfVector& visList = (isOrthogonal) ? 
+                BestNode.inf->orthogVisList : polyLineEdges;
         if (isOrthogonal)
         {
             // We would like to explore in a structured way, 
             // so sort the points in the visList...
             CmpVisEdgeRotation compare(prevInf);
-            visList.sort(compare);
+            insertionSortEdges(visList, compare);
         }
-        EdgeInfList::const_iterator finish = visList.end();
-        for (EdgeInfList::const_iterator edge = visList.begin(); 
+        else
+        {
+            polyLineEdges.assign(BestNode.inf->visList.begin(),
+                    BestNode.inf->visList.end());
+        }
+        EdgeInfVector::const_iterator finish = visList.end();
+        for (EdgeInfVector::const_iterator edge = visList.begin(); 
                 edge != finish; ++edge)
         {
             Node = ANode((*edge)->otherVert(BestNode.inf), timestamp++);
@@ -677,7 +934,7 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
             Node.prevIndex = DONE_size - 1;
 
             VertInf *prevInf = (BestNode.prevIndex >= 0) ?
-                    DONE[BestNode.prevIndex].inf : NULL;
+                    pool.doneNode(BestNode.prevIndex).inf : NULL;
 
             // Don't bother looking at the segment we just arrived along.
             if (prevInf && (prevInf == Node.inf))
@@ -786,11 +1043,12 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
             }
 
             Node.g = BestNode.g + cost(lineRef, edgeDist, BestNode.inf, 
-                    Node.inf, DONE, BestNode.prevIndex);
+                    Node.inf, pool, BestNode.prevIndex);
 
             // Calculate the Heuristic.
             Node.h = estimatedCost(lineRef, &(BestNode.inf->point),
-                    Node.inf->point, tar->point);
+                    Node.inf->point, tar->point, 
+                    landmarkBound.lowerBound(Node.inf));
 
             // The A* formula
             Node.f = Node.g + Node.h;
@@ -804,20 +1062,25 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
 
             bNodeFound = false;
 
-            // Check to see if already on PENDING
-            size_t PENDING_size = PENDING.size();
-            for (unsigned int i = 0; i < PENDING_size; i++)
+            // Check to see if already on PENDING.  As for DONE below, we
+            // look at just the ANodes queued for this vertex.
+            for (std::vector<unsigned int>::iterator currInd = 
+                    Node.inf->aStarPendingIndexes.begin();
+                    currInd != Node.inf->aStarPendingIndexes.end(); ++currInd)
             {
-                ANode& ati = PENDING[i];
-                if ((Node.inf == ati.inf) &&
-                        (DONE[Node.prevIndex].inf == DONE[ati.prevIndex].inf))
+                if (!PENDING.isQueued(*currInd))
+                {
+                    continue;
+                }
+                ANode& ati = PENDING.node(*currInd);
+                if (pool.doneNode(Node.prevIndex).inf == 
+                        pool.doneNode(ati.prevIndex).inf)
                 {
                     // If already on PENDING
                     if (Node.g < ati.g)
                     {
-                        PENDING[i] = Node;
-
-                        make_heap( PENDING.begin(), PENDING.end() );
+                        PENDING.remove(*currInd);
+                        *currInd = PENDING.push(Node);
                     }
                     bNodeFound = true;
                     break;
@@ -832,13 +1095,14 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
                 // using a hash map for DONE, especially since a good hash 
                 // function on the unique combination of vertex and previous 
                 // vertex is very difficult.
-                for (std::list<unsigned int>::const_iterator currInd = 
+                for (std::vector<unsigned int>::const_iterator currInd = 
                         Node.inf->aStarDoneIndexes.begin();
                         currInd != Node.inf->aStarDoneIndexes.end(); ++currInd)
                 {
-                    ANode& ati = DONE[*currInd];
+                    const ANode& ati = pool.doneNode(*currInd);
                     if ((Node.inf == ati.inf) && 
-                            (DONE[Node.prevIndex].inf == DONE[ati.prevIndex].inf))
+                            (pool.doneNode(Node.prevIndex).inf == 
+                             pool.doneNode(ati.prevIndex).inf))
                     {
                         COLA_ASSERT(Node.g >= (ati.g - 10e-10));
                         // This node is already in DONE, and the current 
@@ -853,9 +1117,7 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
             if (!bNodeFound ) // If Node NOT found on PENDING or DONE
             {
                 // Push NewNode onto PENDING
-                PENDING.push_back(Node);
-                // Push NewNode onto heap
-                push_heap( PENDING.begin(), PENDING.end() );
+                Node.inf->aStarPendingIndexes.push_back(PENDING.push(Node));
 
 #if 0
                 using std::cout; using std::endl;
@@ -870,8 +1132,9 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
                 cout << "DONE:   ";
                 for (unsigned int i = 0; i < DONE_size; i++)
                 {
-                    cout << DONE[i].g << "," << DONE[i].h << ",";
-                    cout << DONE[i].inf << "," << DONE[i].pp << "  ";
+                    const ANode& ati = pool.doneNode(i);
+                    cout << ati.g << "," << ati.h << ",";
+                    cout << ati.inf << "," << ati.pp << "  ";
                 }
                 cout << endl << endl;
 #endif
@@ -879,13 +1142,37 @@ void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar, VertInf *start)
         }
     }
 
-    // Cleanup lists used to store positions in DONE list for ANodes at each
-    // vertex.
-    VertInf *endVert = router->vertices.end();
-    for (VertInf *k = router->vertices.connsBegin(); k != endVert;
-            k = k->lstNext)
+    // Record the region of the graph this search examined: every expanded
+    // vertex along with all of its neighbours, whether or not they were 
+    // queued.  A change outside this region cannot alter the result.
+    for (size_t i = 0; i < DONE_size; ++i)
+    {
+        VertInf *inf = pool.doneNode(i).inf;
+        lineRef->extendSearchRegion(inf->point);
+        if (isOrthogonal)
+        {
+            for (size_t j = 0; j < inf->orthogVisList.size(); ++j)
+            {
+                lineRef->extendSearchRegion(
+                        inf->orthogVisList[j]->otherVert(inf)->point);
+            }
+            continue;
+        }
+        EdgeInfList::const_iterator finish = inf->visList.end();
+        for (EdgeInfList::const_iterator edge = inf->visList.begin(); 
+                edge != finish; ++edge)
+        {
+            lineRef->extendSearchRegion((*edge)->otherVert(inf)->point);
+        }
+    }
+
+    // Cleanup lists used to store positions in DONE list and PENDING for
+    // ANodes at each vertex.  Every such vertex has a node in the pool.
+    for (unsigned int i = 0; i < PENDING.poolSize(); ++i)
     {
-        k->aStarDoneIndexes.clear();
+        VertInf *inf = PENDING.node(i).inf;
+        inf->aStarDoneIndexes.clear();
+        inf->aStarPendingIndexes.clear();
     }
 }
 
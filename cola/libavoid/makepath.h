@@ -27,13 +27,383 @@
 #define AVOID_MAKEPATH_H
 
 
+#include <vector>
+#include <cstddef>
+#include <climits>
+#include <algorithm>
+
+#include "libavoid/assertions.h"
+
+
 namespace Avoid {
 
 class ConnRef;
+class VertInf;
+class Router;
 
 extern void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar,
         VertInf *start);
 
+
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// A node of the A* search, i.e., a vertex reached from a particular 
+// previous vertex.
+//
+class ANode
+{
+    public:
+        VertInf* inf;
+        double g;        // Gone
+        double h;        // Heuristic
+        double f;        // Formula f = g + h
+        
+        int prevIndex;   // Index into DONE for the previous ANode.
+        int timeStamp;   // Time-stamp used to determine exploration order of
+                         // seemingly equal paths during orthogonal routing.
+
+        ANode(VertInf *vinf, int time)
+            : inf(vinf),
+              g(0),
+              h(0),
+              f(0),
+              prevIndex(-1),
+              timeStamp(time)
+        {
+        }
+        ANode()
+            : inf(NULL),
+              g(0),
+              h(0),
+              f(0),
+              prevIndex(-1),
+              timeStamp(-1)
+        {
+        }
+};
+
+extern bool operator<(const ANode &a, const ANode &b);
+
+
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// The priority queue of pending ANodes for the A* search.  Nodes are stored
+// once in a pool and referred to by integer handles.  A node can be removed
+// (when a cheaper path to it is found) just by marking its handle.  Popped
+// and removed nodes stay in the pool until the queue is cleared.
+//
+// By default the queue is a binary heap.  Alternatively, for searches with
+// a consistent heuristic, where the popped f values never decrease, it can
+// be a radix heap keyed on f quantised to 1/fQuantum of a unit.  Nodes with
+// the same quantised f as the last node popped are kept in a binary heap,
+// so nodes still come out in exact ANode order.  The radix heap has 
+// constant time pushes and only ever heapifies small groups of nodes.
+//
+class ANodeQueue
+{
+    public:
+        typedef unsigned long long int Key;
+
+        ANodeQueue()
+            : m_use_radix_heap(false),
+              m_count(0),
+              m_last_key(0)
+        {
+        }
+        // Empties the queue and pool, but keeps their memory for reuse.
+        void clear(const bool useRadixHeap)
+        {
+            m_use_radix_heap = useRadixHeap;
+            m_nodes.clear();
+            m_queued.clear();
+            m_count = 0;
+            m_heap.clear();
+            m_keys.clear();
+            for (size_t i = 0; i < bucketCount; ++i)
+            {
+                m_buckets[i].clear();
+            }
+            m_last_key = 0;
+        }
+        // Frees all memory used by the queue.
+        void release(void)
+        {
+            std::vector<ANode>().swap(m_nodes);
+            std::vector<bool>().swap(m_queued);
+            std::vector<unsigned int>().swap(m_heap);
+            std::vector<Key>().swap(m_keys);
+            for (size_t i = 0; i < bucketCount; ++i)
+            {
+                std::vector<unsigned int>().swap(m_buckets[i]);
+            }
+            clear(false);
+        }
+        size_t bytesAllocated(void) const
+        {
+            size_t bytes = (m_nodes.capacity() * sizeof(ANode)) +
+                    (m_queued.capacity() / CHAR_BIT) +
+                    (m_heap.capacity() * sizeof(unsigned int)) +
+                    (m_keys.capacity() * sizeof(Key));
+            for (size_t i = 0; i < bucketCount; ++i)
+            {
+                bytes += m_buckets[i].capacity() * sizeof(unsigned int);
+            }
+            return bytes;
+        }
+        size_t poolSize(void) const
+        {
+            return m_nodes.size();
+        }
+        bool empty(void) const
+        {
+            return (m_count == 0);
+        }
+        ANode& node(const unsigned int handle)
+        {
+            return m_nodes[handle];
+        }
+        const ANode& node(const unsigned int handle) const
+        {
+            return m_nodes[handle];
+        }
+        // Returns whether the node is still in the queue, i.e., it has 
+        // been neither popped nor removed.
+        bool isQueued(const unsigned int handle) const
+        {
+            return m_queued[handle];
+        }
+        // Adds a node to the pool without queueing it.
+        unsigned int store(const ANode& node)
+        {
+            unsigned int handle = m_nodes.size();
+            m_nodes.push_back(node);
+            m_queued.push_back(false);
+            return handle;
+        }
+        unsigned int push(const ANode& node)
+        {
+            unsigned int handle = store(node);
+            m_queued[handle] = true;
+            ++m_count;
+            if (m_use_radix_heap)
+            {
+                Key key = (Key) (node.f * fQuantum + 0.5);
+                // Rounding could put this just before the last node popped.
+                key = std::max(key, m_last_key);
+                m_keys.push_back(key);
+                insertIntoBucket(handle);
+            }
+            else
+            {
+                m_heap.push_back(handle);
+                std::push_heap(m_heap.begin(), m_heap.end(), 
+                        CmpHandles(m_nodes));
+            }
+            return handle;
+        }
+        void remove(const unsigned int handle)
+        {
+            COLA_ASSERT(m_queued[handle]);
+            m_queued[handle] = false;
+            --m_count;
+        }
+        // Removes and returns the handle of the node with the lowest f.
+        unsigned int pop(void)
+        {
+            COLA_ASSERT(!empty());
+            std::vector<unsigned int>& heap = 
+                    (m_use_radix_heap) ? m_buckets[0] : m_heap;
+            while (true)
+            {
+                if (m_use_radix_heap && heap.empty())
+                {
+                    redistribute();
+                }
+                std::pop_heap(heap.begin(), heap.end(), CmpHandles(m_nodes));
+                unsigned int handle = heap.back();
+                heap.pop_back();
+                if (m_queued[handle])
+                {
+                    remove(handle);
+                    return handle;
+                }
+            }
+        }
+
+    private:
+        // Orders handles as per their ANodes, for use with stl heaps.
+        class CmpHandles
+        {
+            public:
+                CmpHandles(const std::vector<ANode>& nodes)
+                    : m_nodes(nodes)
+                {
+                }
+                bool operator()(const unsigned int lhs, 
+                        const unsigned int rhs) const
+                {
+                    return m_nodes[lhs] < m_nodes[rhs];
+                }
+            private:
+                const std::vector<ANode>& m_nodes;
+        };
+
+        static const double fQuantum;
+        static const size_t bucketCount = sizeof(Key) * CHAR_BIT + 1;
+
+        // Nodes with keys that first differ from the last popped key in 
+        // bit i - 1 go in bucket i.  Bucket 0 holds keys equal to it.
+        size_t bucketFor(const Key key) const
+        {
+            Key diff = key ^ m_last_key;
+            size_t bucket = 0;
+            while (diff)
+            {
+                diff >>= 1;
+                ++bucket;
+            }
+            return bucket;
+        }
+        void insertIntoBucket(const unsigned int handle)
+        {
+            size_t bucket = bucketFor(m_keys[handle]);
+            m_buckets[bucket].push_back(handle);
+            if (bucket == 0)
+            {
+                std::push_heap(m_buckets[0].begin(), m_buckets[0].end(),
+                        CmpHandles(m_nodes));
+            }
+        }
+        // Bucket 0 is empty, so make the smallest key in the first non-empty
+        // bucket the new last key and spread that bucket's nodes into the
+        // lower buckets.
+        void redistribute(void)
+        {
+            size_t bucket = 1;
+            while (true)
+            {
+                COLA_ASSERT(bucket < bucketCount);
+                std::vector<unsigned int>& nodes = m_buckets[bucket];
+                // Discard removed nodes.
+                size_t kept = 0;
+                for (size_t i = 0; i < nodes.size(); ++i)
+                {
+                    if (m_queued[nodes[i]])
+                    {
+                        nodes[kept++] = nodes[i];
+                    }
+                }
+                nodes.resize(kept);
+                if (!nodes.empty())
+                {
+                    break;
+                }
+                ++bucket;
+            }
+
+            std::vector<unsigned int> nodes;
+            nodes.swap(m_buckets[bucket]);
+            m_last_key = m_keys[nodes[0]];
+            for (size_t i = 1; i < nodes.size(); ++i)
+            {
+                m_last_key = std::min(m_last_key, m_keys[nodes[i]]);
+            }
+            for (size_t i = 0; i < nodes.size(); ++i)
+            {
+                size_t newBucket = bucketFor(m_keys[nodes[i]]);
+                COLA_ASSERT(newBucket < bucket);
+                m_buckets[newBucket].push_back(nodes[i]);
+            }
+            std::make_heap(m_buckets[0].begin(), m_buckets[0].end(),
+                    CmpHandles(m_nodes));
+        }
+
+        bool m_use_radix_heap;
+        std::vector<ANode> m_nodes;
+        std::vector<bool> m_queued;
+        size_t m_count;
+        // Binary heap:
+        std::vector<unsigned int> m_heap;
+        // Radix heap:
+        std::vector<Key> m_keys;
+        std::vector<unsigned int> m_buckets[bucketCount];
+        Key m_last_key;
+};
+
+
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// Storage for the nodes of aStarPath() searches.  The router keeps one of
+// these so that the memory is reused by all the searches in a transaction.
+//
+class AStarNodePool
+{
+    public:
+        // Empties the pool for a new search.
+        void clear(const bool useRadixHeap)
+        {
+            pending.clear(useRadixHeap);
+            done.clear();
+        }
+        // Frees all memory used by the pool.
+        void release(void)
+        {
+            pending.release();
+            std::vector<unsigned int>().swap(done);
+        }
+        size_t bytesAllocated(void) const
+        {
+            return pending.bytesAllocated() + 
+                    (done.capacity() * sizeof(unsigned int));
+        }
+        // The node at the given index in the order of expansion.
+        const ANode& doneNode(const int index) const
+        {
+            return pending.node(done[index]);
+        }
+
+        // Every node generated by the search, with those still pending.
+        ANodeQueue pending;
+        // Handles of the expanded nodes, in the order they were expanded.
+        std::vector<unsigned int> done;
+};
+
+
+// Shortest path distances from a small set of landmark vertices to every 
+// vertex of the orthogonal visibility graph.  These allow aStarPath() to 
+// use a lower bound that takes obstacles into account (the ALT technique:
+// A*, Landmarks and the Triangle inequality) rather than just the 
+// Manhattan distance to the target.
+//
+// The distances are only valid for the graph they were computed on, so 
+// any change to the static orthogonal visibility graph invalidates them.
+//
+class AStarLandmarks
+{
+    public:
+        AStarLandmarks();
+        void compute(Router *router, const size_t landmarkCount);
+        void invalidate(void);
+        bool isValid(void) const;
+        size_t size(void) const;
+        bool knowsVertex(const VertInf *vert) const;
+        // The distance from the given landmark to the vertex.  This is 
+        // negative if the vertex is unreachable from that landmark.
+        double distance(const size_t landmark, const VertInf *vert) const;
+
+    private:
+        void shortestPathsFrom(const size_t sourceIndex, 
+                std::vector<double>& dists) const;
+
+        std::vector<VertInf *> m_vertices;
+        std::vector<VertInf *> m_landmarks;
+        // Distances stored landmark-major, i.e., for landmark l and vertex
+        // index v at position (l * m_vertices.size()) + v.
+        std::vector<double> m_distances;
+        bool m_valid;
+};
+
+
 }
 
 
@@ -32,6 +32,7 @@
 */
 
 #include <cfloat>
+#include <climits>
 #include <vector>
 #include <algorithm>
 
@@ -47,21 +48,58 @@ namespace Avoid {
 
 // Comparison for the vertex heap in the extended Dijkstra's algorithm.
 struct HeapCmpVertInf
+{
+    HeapCmpVertInf(MTSTWorkspace *workspace)
+        : workspace(workspace)
+    {
+    }
+    bool operator()(VertInf *a, VertInf *b) const
+    {
+        return workspace->state(a).dist > workspace->state(b).dist;
+    }
+
+    MTSTWorkspace *workspace;
+};
+
+
+// Orders terminals by list index, so searches are deterministic.
+struct CmpVertInfListIndex
 {
     bool operator()(const VertInf *a, const VertInf *b) const
     {
-        return a->sptfDist > b->sptfDist;
+        return a->listIndex < b->listIndex;
     }
 };
 
 
 // Comparison for the bridging edge heap in the extended Kruskal's algorithm.
-struct CmpEdgeInf
+struct CmpBridgingEdge
+{
+    bool operator()(const BridgingEdge& a, const BridgingEdge& b) const
+    {
+        return a.cost > b.cost;
+    }
+};
+
+
+// Orders the bridging edge list by edge, then by the order edges were 
+// added, so each edge's copies can be grouped together.
+struct CmpBridgingEdgeIndexes
 {
-    bool operator()(const EdgeInf *a, const EdgeInf *b) const
+    CmpBridgingEdgeIndexes(const std::vector<BridgingEdge>& edges)
+        : edges(edges)
     {
-        return a->mtstDist() > b->mtstDist();
     }
+    bool operator()(size_t a, size_t b) const
+    {
+        if (edges[a].edge != edges[b].edge)
+        {
+            return edges[a].edge < edges[b].edge;
+        }
+        return a < b;
+    }
+
+    const std::vector<BridgingEdge>& edges;
 };
 
 
@@ -72,12 +110,100 @@ struct delete_object
 };
 
 
+// Set on the listIndex of dummy vertices added by a search.
+static const unsigned int extraVertexFlag = 1u << 31;
+
+
+MTSTWorkspace::MTSTWorkspace()
+    : m_epoch(0)
+{
+}
+
+
+void MTSTWorkspace::beginSearch(void)
+{
+    ++m_epoch;
+    if (m_epoch == 0)
+    {
+        // The epoch has wrapped around, so clear any old stamps.
+        std::fill(m_stamps.begin(), m_stamps.end(), 0);
+        m_epoch = 1;
+    }
+    m_extra_states.clear();
+    m_extra_edge_links.clear();
+}
+
+
+void MTSTWorkspace::addExtraVertex(VertInf *vertex)
+{
+    COLA_ASSERT(vertex->listIndex == UINT_MAX);
+    vertex->listIndex = extraVertexFlag | m_extra_states.size();
+    SptfVertexState initial = { DBL_MAX, NULL, vertex, -1 };
+    m_extra_states.push_back(initial);
+}
+
+
+void MTSTWorkspace::addExtraEdge(EdgeInf *edge, VertInf *vert1, 
+        VertInf *vert2)
+{
+    VertInf *ends[2] = { vert1, vert2 };
+    for (size_t i = 0; i < 2; ++i)
+    {
+        SptfVertexState& endState = state(ends[i]);
+        ExtraEdgeLink link = { edge, endState.firstExtraEdge };
+        endState.firstExtraEdge = (int) m_extra_edge_links.size();
+        m_extra_edge_links.push_back(link);
+    }
+}
+
+
+void MTSTWorkspace::appendExtraEdges(VertInf *vertex, 
+        std::vector<EdgeInf *>& edges)
+{
+    for (int link = state(vertex).firstExtraEdge; link != -1; 
+            link = m_extra_edge_links[link].next)
+    {
+        edges.push_back(m_extra_edge_links[link].edge);
+    }
+}
+
+
+SptfVertexState& MTSTWorkspace::state(VertInf *vertex)
+{
+    const unsigned int index = vertex->listIndex;
+    COLA_ASSERT(index != UINT_MAX);
+    if (index & extraVertexFlag)
+    {
+        return m_extra_states[index & ~extraVertexFlag];
+    }
+    if (index >= m_stamps.size())
+    {
+        size_t newSize = std::max((size_t) index + 1, 2 * m_stamps.size());
+        m_states.resize(newSize);
+        m_stamps.resize(newSize, 0);
+    }
+    SptfVertexState& vertexState = m_states[index];
+    if (m_stamps[index] != m_epoch)
+    {
+        // Not reached yet in this search.
+        m_stamps[index] = m_epoch;
+        vertexState.dist = DBL_MAX;
+        vertexState.pathNext = NULL;
+        vertexState.root = vertex;
+        vertexState.firstExtraEdge = -1;
+    }
+    return vertexState;
+}
+
+
 MinimumTerminalSpanningTree::MinimumTerminalSpanningTree(Router *router,
         std::set<VertInf *> terminals,
-        JunctionHyperEdgeTreeNodeMap *hyperEdgeTreeJunctions)
+        JunctionHyperEdgeTreeNodeMap *hyperEdgeTreeJunctions,
+        MTSTWorkspace *workspace)
     : router(router),
       terminals(terminals),
       hyperEdgeTreeJunctions(hyperEdgeTreeJunctions),
+      m_workspace((workspace) ? workspace : &m_own_workspace),
       m_rootJunction(NULL),
       bendCost(2000),
       debug_fp(NULL),
@@ -152,10 +278,12 @@ HyperEdgeTreeNode *MinimumTerminalSpanningTree::addNode(VertInf *vertex,
     {
         // Found.
         HyperEdgeTreeNode *junctionNode = match->second;
-        if (junctionNode->junction == NULL)
+        if (std::find(m_junction_nodes.begin(), m_junction_nodes.end(),
+                junctionNode) == m_junction_nodes.end())
         {
-            // Create a junction, if one has not already been created.
-            junctionNode->junction = new JunctionRef(router, vertex->point);
+            // Mark it as a junction, if it has not already been marked.
+            // The junction itself is created by createJunctions().
+            m_junction_nodes.push_back(junctionNode);
             if (m_rootJunction == NULL)
             {
                 // Remember the first junction node, so we can use it to 
@@ -163,8 +291,6 @@ HyperEdgeTreeNode *MinimumTerminalSpanningTree::addNode(VertInf *vertex,
                 // junctions and endpoints.
                 m_rootJunction = junctionNode;
             }
-            router->removeObjectFromQueuedActions(junctionNode->junction);
-            junctionNode->junction->makeActive();
         }
         // Joint to junction
         new HyperEdgeTreeEdge(prevNode, junctionNode, NULL);
@@ -200,7 +326,8 @@ void MinimumTerminalSpanningTree::buildHyperEdgeTreeToRoot(VertInf *currVert,
             break;
         }
 
-        if (currVert->pathNext == NULL)
+        VertInf *pathNext = m_workspace->state(currVert).pathNext;
+        if (pathNext == NULL)
         {
             // This is a terminal of the hyperedge, mark the node with the 
             // vertex representing the endpoint of the connector so we can
@@ -208,47 +335,103 @@ void MinimumTerminalSpanningTree::buildHyperEdgeTreeToRoot(VertInf *currVert,
             addedNode->finalVertex = currVert;
         }
         prevNode = addedNode;
-        currVert = currVert->pathNext;
+        currVert = pathNext;
+    }
+}
+
+
+// Returns the cost of joining the trees at either end of the given edge,
+// reached from the vertex 'from'.
+double MinimumTerminalSpanningTree::bridgingEdgeCost(EdgeInf *edge,
+        VertInf *from)
+{
+    VertInf *other = edge->otherVert(from);
+
+    // The default cost is the cost back to the root of each forest plus the
+    // length of this edge.
+    double cost = m_workspace->state(edge->m_vert1).dist + 
+            m_workspace->state(edge->m_vert2).dist + edge->getDist();
+
+    // If the other end is connecting to a forest via a bend, then add a
+    // penalty for it.  Note, the penalty is already added for the side
+    // we are connecting from.
+    VertInf *otherNext = m_workspace->state(other).pathNext;
+    if (otherNext && ! colinear(otherNext->point, other->point, from->point))
+    {
+        cost += bendCost;
     }
+    return cost;
 }
 
 
 void MinimumTerminalSpanningTree::execute(void)
+{
+    router->timers.Register(tmHyperedgeForest, timerStart);
+    buildForest();
+    router->timers.Stop();
+
+    router->timers.Register(tmHyperedgeMTST, timerStart);
+    buildTree();
+    router->timers.Stop();
+}
+
+
+void MinimumTerminalSpanningTree::constructTree(void)
+{
+    buildForest();
+    buildTree();
+}
+
+
+void MinimumTerminalSpanningTree::releaseWorkspace(void)
+{
+    m_workspace = &m_own_workspace;
+}
+
+
+void MinimumTerminalSpanningTree::createJunctions(void)
+{
+    for (size_t i = 0; i < m_junction_nodes.size(); ++i)
+    {
+        HyperEdgeTreeNode *junctionNode = m_junction_nodes[i];
+        COLA_ASSERT(junctionNode->junction == NULL);
+        junctionNode->junction = new JunctionRef(router, junctionNode->point);
+        router->removeObjectFromQueuedActions(junctionNode->junction);
+        junctionNode->junction->makeActive();
+    }
+}
+
+
+void MinimumTerminalSpanningTree::buildForest(void)
 {
     // Perform extended Dijkstra's algorithm
     // =====================================
     //
-    router->timers.Register(tmHyperedgeForest, timerStart);
     bool isOrthogonal = true;
 
     // Vertex heap for extended Dijkstra's algorithm.
     std::vector<VertInf *> vHeap;
-    HeapCmpVertInf vHeapCompare;
+    HeapCmpVertInf vHeapCompare(m_workspace);
 
-    // Bridging edge heap for the extended Kruskal's algorithm.
-    std::vector<EdgeInf *> beHeap;
-    CmpEdgeInf beHeapCompare;
+    // The edges from the vertex being explored.
+    std::vector<EdgeInf *> edges;
 
     // Initialisation
     //
-    VertInf *endVert = router->vertices.end();
-    for (VertInf *k = router->vertices.connsBegin(); k != endVert;
-            k = k->lstNext)
+    // Only the terminals need setting up.  Other vertices are treated as 
+    // unreached, with the maximum distance, the first time the workspace 
+    // returns their state.
+    m_workspace->beginSearch();
+    std::vector<VertInf *> sortedTerminals(terminals.begin(), terminals.end());
+    std::sort(sortedTerminals.begin(), sortedTerminals.end(), 
+            CmpVertInfListIndex());
+    for (size_t i = 0; i < sortedTerminals.size(); ++i)
     {
-        if (terminals.find(k) != terminals.end())
-        {
-            // This is a terminal, set a distance of zero.
-            k->sptfDist = 0;
-            makeSet(k);
-            vHeap.push_back(k);
-        }
-        else
-        {
-            // This is a non-terminal vertex.  Assign it the maximum distance.
-            k->sptfDist = DBL_MAX;
-        }
-        k->pathNext = NULL;
-        k->sptfRoot = k;
+        VertInf *k = sortedTerminals[i];
+        // This is a terminal, set a distance of zero.
+        m_workspace->state(k).dist = 0;
+        makeSet(k);
+        vHeap.push_back(k);
     }
     std::make_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
     
@@ -266,20 +449,31 @@ void MinimumTerminalSpanningTree::execute(void)
     {
         // Take the lowest vertex from heap.
         VertInf *u = vHeap.front();
+        // A copy, since adding dummy vertices may move the original.
+        const SptfVertexState uState = m_workspace->state(u);
 
         // Pop the lowest vertex off the heap.
         std::pop_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
         vHeap.pop_back();
 
-        // For each edge from this vertex...
-        EdgeInfList& visList = (!isOrthogonal) ? u->visList : u->orthogVisList;
-        EdgeInfList::const_iterator finish = visList.end();
+        // For each edge from this vertex, dummy edges first...
+        edges.clear();
+        m_workspace->appendExtraEdges(u, edges);
+        if (isOrthogonal)
+        {
+            edges.insert(edges.end(), u->orthogVisList.begin(),
+                    u->orthogVisList.end());
+        }
+        else
+        {
+            edges.insert(edges.end(), u->visList.begin(), u->visList.end());
+        }
         VertInf *extraVertex = NULL;
-        for (EdgeInfList::const_iterator edge = visList.begin(); 
-                edge != finish; ++edge)
+        for (size_t i = 0; i < edges.size(); ++i)
         {
-            VertInf *v = (*edge)->otherVert(u);
-            double edgeDist = (*edge)->getDist();
+            EdgeInf *edge = edges[i];
+            VertInf *v = edge->otherVert(u);
+            double edgeDist = edge->getDist();
 
             // Assign a distance (length) of 1 for dummy visibility edges
             // which may not accurately reflect the real distance of the edge.
@@ -289,15 +483,15 @@ void MinimumTerminalSpanningTree::execute(void)
             }
 
             // Ignore an edge we have already explored.
-            if (u->pathNext == v || 
-                    (u->pathNext && u->pathNext->pathNext == v))
+            if (uState.pathNext == v || (uState.pathNext && 
+                    m_workspace->state(uState.pathNext).pathNext == v))
             {
                 continue;
             }
 
             // Don't do anything more here if this is an intra-tree edge that
             // would just bridge branches of the same tree.
-            if (u->sptfRoot == v->sptfRoot)
+            if (uState.root == m_workspace->state(v).root)
             {
                 continue;
             }
@@ -313,8 +507,8 @@ void MinimumTerminalSpanningTree::execute(void)
             // original edges, so these may be explored when the algorithm
             // explores the dummy node.  Obviously we also need to clean up
             // these dummy nodes and edges later.
-            double newCost = (u->sptfDist + edgeDist);
-            if (u->pathNext && ! colinear(u->pathNext->point, 
+            double newCost = (uState.dist + edgeDist);
+            if (uState.pathNext && ! colinear(uState.pathNext->point, 
                     u->point, v->point))
             {
                 // This edge is not colinear, so add it to the dummy node and
@@ -326,21 +520,28 @@ void MinimumTerminalSpanningTree::execute(void)
                     extraVertex = new VertInf(router, dimensionChangeVertexID,
                            u->point, false);
                     extraVertices.push_back(extraVertex);
-                    extraVertex->sptfDist = bendCost + u->sptfDist;
-                    extraVertex->pathNext = u;
-                    extraVertex->sptfRoot = u->sptfRoot;
+                    m_workspace->addExtraVertex(extraVertex);
+                    SptfVertexState& extraState = 
+                            m_workspace->state(extraVertex);
+                    extraState.dist = bendCost + uState.dist;
+                    extraState.pathNext = u;
+                    extraState.root = uState.root;
                     vHeap.push_back(extraVertex);
                     std::push_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
                 }
                 // Add a copy of the ignored edge to the dummy node, so it
-                // may be explored later.
-                EdgeInf *extraEdge = new EdgeInf(extraVertex, v, true);
-                extraEdge->setDist(edgeDist);
+                // may be explored later.  This is kept in the workspace 
+                // rather than being made active in the visibility graph.
+                EdgeInf *extraEdge = 
+                        new (router, true) EdgeInf(extraVertex, v, true);
+                extraEdge->m_dist = edgeDist;
+                m_workspace->addExtraEdge(extraEdge, extraVertex, v);
                 extraEdges.push_back(extraEdge);
                 continue;
             }
  
-            if (newCost < v->sptfDist && v->sptfRoot == v)
+            SptfVertexState& vState = m_workspace->state(v);
+            if (newCost < vState.dist && vState.root == v)
             {
                 // We have got to a node we haven't explored to from any tree.
                 // So attach it to the tree and update it with the distance
@@ -355,9 +556,9 @@ void MinimumTerminalSpanningTree::execute(void)
                             u->point.y, "purple");
                 }
 
-                v->sptfDist = newCost;
-                v->pathNext = u;
-                v->sptfRoot = u->sptfRoot;
+                vState.dist = newCost;
+                vState.pathNext = u;
+                vState.root = uState.root;
                 vHeap.push_back(v);
                 std::push_heap(vHeap.begin(), vHeap.end(), vHeapCompare);
             }
@@ -367,23 +568,48 @@ void MinimumTerminalSpanningTree::execute(void)
                 // a different tree.  Set the MTST distance for the bridging
                 // edge and push it to the priority queue of edges to consider
                 // during the extended Kruskal's algorithm.
-                (*edge)->setMtstDist(u, bendCost);
-                beHeap.push_back(*edge);
+                BridgingEdge bridgingEdge = { edge, bridgingEdgeCost(edge, u) };
+                m_bridging_edges.push_back(bridgingEdge);
             }
         }
     }
-    // Make the bridging edge heap.
-    std::make_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
+
+    // An edge may have been added more than once, from each end.  Give all
+    // its copies the cost from when it was last added.
+    std::vector<size_t> indexes(m_bridging_edges.size());
+    for (size_t i = 0; i < indexes.size(); ++i)
+    {
+        indexes[i] = i;
+    }
+    std::sort(indexes.begin(), indexes.end(), 
+            CmpBridgingEdgeIndexes(m_bridging_edges));
+    for (size_t i = indexes.size(); i > 1; --i)
+    {
+        const BridgingEdge& later = m_bridging_edges[indexes[i - 1]];
+        BridgingEdge& earlier = m_bridging_edges[indexes[i - 2]];
+        if (earlier.edge == later.edge)
+        {
+            earlier.cost = later.cost;
+        }
+    }
     if (debug_fp)
     {
         fprintf(debug_fp, "</g>\n");
     }
-    router->timers.Stop();
+}
+
 
+void MinimumTerminalSpanningTree::buildTree(void)
+{
     // Perform extended Kruskal's algorithm
     // ====================================
     //
-    router->timers.Register(tmHyperedgeMTST, timerStart);
+
+    // Bridging edge heap for the extended Kruskal's algorithm.
+    std::vector<BridgingEdge>& beHeap = m_bridging_edges;
+    CmpBridgingEdge beHeapCompare;
+    std::make_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
+
     if (debug_fp)
     {
         fprintf(debug_fp, "<g inkscape:groupmode=\"layer\" "
@@ -393,15 +619,17 @@ void MinimumTerminalSpanningTree::execute(void)
     while ( ! beHeap.empty() )
     {
         // Take the lowest cost edge.
-        EdgeInf *e = beHeap.front();
+        EdgeInf *e = beHeap.front().edge;
 
         // Pop the lowest cost edge off of the heap.
         std::pop_heap(beHeap.begin(), beHeap.end(), beHeapCompare);
         beHeap.pop_back();
 
         // Find the sets of terminals that each of the trees connects.
-        VertexSetList::iterator s1 = findSet(e->m_vert1->sptfRoot);
-        VertexSetList::iterator s2 = findSet(e->m_vert2->sptfRoot);
+        VertexSetList::iterator s1 = 
+                findSet(m_workspace->state(e->m_vert1).root);
+        VertexSetList::iterator s2 = 
+                findSet(m_workspace->state(e->m_vert2).root);
 
         if ((s1 == allsets.end()) || (s2 == allsets.end()))
         {
@@ -444,8 +672,10 @@ void MinimumTerminalSpanningTree::execute(void)
                         e->m_vert1->point.y, e->m_vert2->point.x,
                         e->m_vert2->point.y, "red");
             }
-            buildHyperEdgeTreeToRoot(e->m_vert1->pathNext, node1);
-            buildHyperEdgeTreeToRoot(e->m_vert2->pathNext, node2);
+            buildHyperEdgeTreeToRoot(
+                    m_workspace->state(e->m_vert1).pathNext, node1);
+            buildHyperEdgeTreeToRoot(
+                    m_workspace->state(e->m_vert2).pathNext, node2);
         }
     }
     if (debug_fp)
@@ -456,8 +686,8 @@ void MinimumTerminalSpanningTree::execute(void)
     // Free the dummy nodes and edges created earlier.
     for_each(extraEdges.begin(), extraEdges.end(), delete_object());
     for_each(extraVertices.begin(), extraVertices.end(), delete_object());
-
-    router->timers.Stop();
+    extraEdges.clear();
+    extraVertices.clear();
 }
 
 }
@@ -28,6 +28,7 @@
 #include <cstdio>
 #include <set>
 #include <list>
+#include <vector>
 
 #include "libavoid/hyperedgetree.h"
 
@@ -41,6 +42,66 @@ class EdgeInf;
 
 typedef std::list<VertexSet> VertexSetList;
 
+
+// The state of a vertex in the shortest path terminal forest: the distance
+// back to the root of its tree, the next vertex on the path to the root, 
+// and the root terminal itself.  Also the head of the list of dummy edges
+// the search has added at this vertex.
+struct SptfVertexState
+{
+    double dist;
+    VertInf *pathNext;
+    VertInf *root;
+    int firstExtraEdge;
+};
+
+
+// A candidate edge for joining two trees of the shortest path terminal 
+// forest, with the cost of the join.
+struct BridgingEdge
+{
+    EdgeInf *edge;
+    double cost;
+};
+
+
+// This class is not intended for public use.
+// Per-vertex state for MTST searches, kept in arrays indexed by the 
+// vertices' VertInf::listIndex.  Each entry is stamped with the epoch of 
+// the search that last set it, so a workspace can be reused by successive
+// searches without being reset and each search only touches the vertices
+// it actually reaches.  Dummy vertices created by a search, which aren't
+// in the router's vertex list, have their state kept separately.  Dummy 
+// edges are likewise only listed here, rather than being added to the 
+// visibility graph, so that searches never modify the shared graph.
+class MTSTWorkspace
+{
+    public:
+        MTSTWorkspace();
+        void beginSearch(void);
+        void addExtraVertex(VertInf *vertex);
+        void addExtraEdge(EdgeInf *edge, VertInf *vert1, VertInf *vert2);
+        // Appends the dummy edges at the vertex, most recently added first.
+        void appendExtraEdges(VertInf *vertex, 
+                std::vector<EdgeInf *>& edges);
+        // Returns the state of the vertex in the current search.  This is 
+        // initialised to being unreached if it hasn't yet been set.
+        SptfVertexState& state(VertInf *vertex);
+
+    private:
+        struct ExtraEdgeLink
+        {
+            EdgeInf *edge;
+            int next;
+        };
+
+        std::vector<SptfVertexState> m_states;
+        std::vector<unsigned int> m_stamps;
+        std::vector<SptfVertexState> m_extra_states;
+        std::vector<ExtraEdgeLink> m_extra_edge_links;
+        unsigned int m_epoch;
+};
+
 // This class is not intended for public use.
 // It is used by the hyperedge routing code to build a minimum terminal
 // spanning tree for a set of terminal vertices.
@@ -49,12 +110,27 @@ class MinimumTerminalSpanningTree
     public:
         MinimumTerminalSpanningTree(Router *router,
                 std::set<VertInf *> terminals,
-                JunctionHyperEdgeTreeNodeMap *hyperEdgeTreeJunctions = NULL);
+                JunctionHyperEdgeTreeNodeMap *hyperEdgeTreeJunctions = NULL,
+                MTSTWorkspace *workspace = NULL);
         void setDebuggingOutput(FILE *fp, unsigned int counter);
+        // Builds the tree, without creating junctions or modifying the 
+        // router or its visibility graph.
         void execute(void);
+        // The same as execute(), but doesn't update the router's timers.
+        // Trees for different terminal sets may be constructed this way 
+        // concurrently, provided each uses its own workspace.
+        void constructTree(void);
+        // Stops using the workspace passed to the constructor, so that it 
+        // can be freed once the tree has been built.  The remaining steps
+        // don't need one.
+        void releaseWorkspace(void);
+        // Creates and activates the junctions for the tree.
+        void createJunctions(void);
         HyperEdgeTreeNode *rootJunction(void) const;
 
     private:
+        void buildForest(void);
+        void buildTree(void);
         void buildHyperEdgeTreeToRoot(VertInf *curr,
                 HyperEdgeTreeNode *prevNode);
 
@@ -62,10 +138,13 @@ class MinimumTerminalSpanningTree
         VertexSetList::iterator findSet(VertInf *vertex);
         void unionSets(VertexSetList::iterator s1, VertexSetList::iterator s2);
         HyperEdgeTreeNode *addNode(VertInf *vertex, HyperEdgeTreeNode *prevNode);
+        double bridgingEdgeCost(EdgeInf *edge, VertInf *from);
 
         Router *router;
         std::set<VertInf *> terminals;
         JunctionHyperEdgeTreeNodeMap *hyperEdgeTreeJunctions;
+        MTSTWorkspace m_own_workspace;
+        MTSTWorkspace *m_workspace;
 
         VertexNodeMap nodes;
         HyperEdgeTreeNode *m_rootJunction;
@@ -73,6 +152,8 @@ class MinimumTerminalSpanningTree
         VertexSetList allsets;
         std::list<VertInf *> extraVertices;
         std::list<EdgeInf *> extraEdges;
+        std::vector<BridgingEdge> m_bridging_edges;
+        std::vector<HyperEdgeTreeNode *> m_junction_nodes;
 
         FILE *debug_fp;
         unsigned int debug_count;
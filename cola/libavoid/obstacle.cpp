@@ -27,6 +27,7 @@
 #include "libavoid/router.h"
 #include "libavoid/connectionpin.h"
 #include "libavoid/debug.h"
+#include "libavoid/bboxindex.h"
 
 namespace Avoid {
 
@@ -117,6 +118,11 @@ void Obstacle::setNewPoly(const Polygon& poly)
         
     m_polygon = poly;
 
+    // Clusters may reference this obstacle's polygon, so both bounding
+    // box indexes may now be stale.
+    m_router->m_obstacle_bbox_index->invalidate();
+    m_router->m_cluster_bbox_index->invalidate();
+
     // It may be that the polygon for the obstacle has been updated after
     // creating the shape.  These events may have been combined for a single
     // transaction, so update pin positions.
@@ -136,6 +142,7 @@ void Obstacle::makeActive(void)
     // Add to shapeRefs list.
     m_router_obstacles_pos = m_router->m_obstacles.insert(
             m_router->m_obstacles.begin(), this);
+    m_router->m_obstacle_bbox_index->invalidate();
 
     // Add points to vertex list.
     VertInf *it = m_first_vert;
@@ -158,6 +165,7 @@ void Obstacle::makeInactive(void)
     
     // Remove from shapeRefs list.
     m_router->m_obstacles.erase(m_router_obstacles_pos);
+    m_router->m_obstacle_bbox_index->invalidate();
 
     // Remove points from vertex list.
     VertInf *it = m_first_vert;
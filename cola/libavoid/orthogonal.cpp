@@ -42,6 +42,7 @@
 #include "libavoid/assertions.h"
 #include "libavoid/hyperedgetree.h"
 #include "libavoid/mtst.h"
+#include "libavoid/blockpool.h"
 
 //#define NUDGE_DEBUG
 
@@ -329,6 +330,60 @@ class CmpIndexes
 };
 
 
+// Storage for the solver variables and constraints used for nudging.
+// These are allocated from pools and released together after each region
+// of overlapping segments has been nudged, so the same memory is reused
+// for every region, in both dimensions.  Only this storage is reused: each
+// separation attempt still builds and solves its own IncSolver.
+class NudgingSolverStorage
+{
+    public:
+        NudgingSolverStorage()
+            : m_variable_pool(sizeof(Variable)),
+              m_constraint_pool(sizeof(Constraint))
+        {
+        }
+        Variable *newVariable(const int id, const double desiredPos,
+                const double weight)
+        {
+            Variable *variable = new (m_variable_pool.allocate())
+                    Variable(id, desiredPos, weight);
+            m_variables.push_back(variable);
+            return variable;
+        }
+        Constraint *newConstraint(Variable *left, Variable *right,
+                const double gap, const bool equality = false)
+        {
+            Constraint *constraint = new (m_constraint_pool.allocate())
+                    Constraint(left, right, gap, equality);
+            m_constraints.push_back(constraint);
+            return constraint;
+        }
+        // Destroys all the variables and constraints, reclaiming their
+        // storage for the next region.
+        void clear(void)
+        {
+            for (size_t i = 0; i < m_variables.size(); ++i)
+            {
+                m_variables[i]->~Variable();
+            }
+            for (size_t i = 0; i < m_constraints.size(); ++i)
+            {
+                m_constraints[i]->~Constraint();
+            }
+            m_variables.clear();
+            m_constraints.clear();
+            m_variable_pool.reset();
+            m_constraint_pool.reset();
+        }
+    private:
+        BlockPool m_variable_pool;
+        BlockPool m_constraint_pool;
+        Variables m_variables;
+        Constraints m_constraints;
+};
+
+
 class NudgingShiftSegment : public ShiftSegment
 {
     public:
@@ -397,7 +452,7 @@ class NudgingShiftSegment : public ShiftSegment
         {
             return ! zigzag();
         }
-        void createSolverVariable(void)
+        void createSolverVariable(NudgingSolverStorage& storage)
         {
             bool nudgeFinalSegments = connRef->router()->routingOption(
                     nudgeOrthogonalSegmentsConnectedToShapes);
@@ -434,7 +489,7 @@ class NudgingShiftSegment : public ShiftSegment
                 weight = strongWeight;
             }
 
-            variable = new Variable(varID, varPos, weight);
+            variable = storage.newVariable(varID, varPos, weight);
         }
 
         void updatePositionsFromSolver(void)
@@ -1177,7 +1232,8 @@ public:
         }
         if (!found)
         {
-            found = new VertInf(router, dummyOrthogID, Point(posX, pos));
+            found = new (router)
+                    VertInf(router, dummyOrthogID, Point(posX, pos));
             vertInfs.insert(found);
         }
         return found;
@@ -1195,7 +1251,7 @@ public:
         {
             if (begin != -DBL_MAX)
             {
-                vertInfs.insert(new
+                vertInfs.insert(new (router)
                         VertInf(router, dummyOrthogID, Point(begin, pos)));
             }
         }
@@ -1214,7 +1270,7 @@ public:
         {
             if (finish != DBL_MAX)
             {
-                vertInfs.insert(new
+                vertInfs.insert(new (router)
                         VertInf(router, dummyOrthogID, Point(finish, pos)));
             }
         }
@@ -1447,7 +1503,8 @@ public:
                 // Add begin point.
                 Point point(pos, pos);
                 point[dim] = begin;
-                VertInf *vert = new VertInf(router, dummyOrthogID, point);
+                VertInf *vert = new (router)
+                        VertInf(router, dummyOrthogID, point);
                 breakPoints.insert(PosVertInf(begin, vert));
             }
         }
@@ -1467,7 +1524,8 @@ public:
                 // Add begin point.
                 Point point(pos, pos);
                 point[dim] = finish;
-                VertInf *vert = new VertInf(router, dummyOrthogID, point);
+                VertInf *vert = new (router)
+                        VertInf(router, dummyOrthogID, point);
                 breakPoints.insert(PosVertInf(finish, vert));
             }
         }
@@ -1528,8 +1586,9 @@ public:
                     bool canSeeDown = (vert->dirs & VisDirDown);
                     if (canSeeDown && !(side->vert->id.isConnPt()))
                     {
-                        EdgeInf *edge = new 
-                                EdgeInf(side->vert, vert->vert, orthogonal);
+                        EdgeInf *edge = new (side->vert->_router,
+                                orthogonal) EdgeInf(side->vert, vert->vert,
+                                orthogonal);
                         edge->setDist(vert->vert->point[dim] - 
                                 side->vert->point[dim]);
                     }
@@ -1545,8 +1604,9 @@ public:
                     bool canSeeUp = (last->dirs & VisDirUp);
                     if (canSeeUp && (side != breakPoints.end()))
                     {
-                        EdgeInf *edge = new 
-                                EdgeInf(last->vert, side->vert, orthogonal);
+                        EdgeInf *edge = new (side->vert->_router,
+                                orthogonal) EdgeInf(last->vert, side->vert,
+                                orthogonal);
                         edge->setDist(side->vert->point[dim] - 
                                 last->vert->point[dim]);
                     }
@@ -1574,8 +1634,8 @@ public:
                 }
                 if (generateEdge)
                 {
-                    EdgeInf *edge = 
-                            new EdgeInf(last->vert, vert->vert, orthogonal);
+                    EdgeInf *edge = new (last->vert->_router, orthogonal)
+                            EdgeInf(last->vert, vert->vert, orthogonal);
                     edge->setDist(vert->vert->point[dim] - 
                             last->vert->point[dim]);
                 }
@@ -1681,6 +1741,7 @@ static void intersectSegments(Router *router, SegmentList& segments,
     for (SegmentList::iterator it = segments.begin(); it != segments.end(); )
     {
         LineSegment& horiLine = *it;
+        router->timers.Count(ctVisibilityChecks);
 
         bool inVertSegRegion = ((vertLine.begin <= horiLine.pos) &&
                                 (vertLine.finish >= horiLine.pos));
@@ -1811,9 +1872,9 @@ static void processEventVert(Router *router, NodeSet& scanline,
             if (minLimitMax >= maxLimitMin)
             {
                 // These vertices represent the shape corners.
-                VertInf *vI1 = new VertInf(router, dummyOrthogShapeID, 
+                VertInf *vI1 = new (router) VertInf(router, dummyOrthogShapeID, 
                             Point(minShape, lineY));
-                VertInf *vI2 = new VertInf(router, dummyOrthogShapeID, 
+                VertInf *vI2 = new (router) VertInf(router, dummyOrthogShapeID, 
                             Point(maxShape, lineY));
                 
                 // There are no overlapping shapes, so give full visibility.
@@ -1839,7 +1900,8 @@ static void processEventVert(Router *router, NodeSet& scanline,
                     LineSegment *line = segments.insert(
                             LineSegment(minLimit, minLimitMax, lineY, true));
                     // Shape corner:
-                    VertInf *vI1 = new VertInf(router, dummyOrthogShapeID, 
+                    VertInf *vI1 = new (router)
+                            VertInf(router, dummyOrthogShapeID, 
                                 Point(minShape, lineY));
                     line->vertInfs.insert(vI1);
                 }
@@ -1848,7 +1910,8 @@ static void processEventVert(Router *router, NodeSet& scanline,
                     LineSegment *line = segments.insert(
                             LineSegment(maxLimitMin, maxLimit, lineY, true));
                     // Shape corner:
-                    VertInf *vI2 = new VertInf(router, dummyOrthogShapeID, 
+                    VertInf *vI2 = new (router)
+                            VertInf(router, dummyOrthogShapeID, 
                                 Point(maxShape, lineY));
                     line->vertInfs.insert(vI2);
                 }
@@ -1894,7 +1957,8 @@ static void processEventVert(Router *router, NodeSet& scanline,
                 // *through* connector endpoint vertices).
                 if (line1 || line2)
                 {
-                    VertInf *cent = new VertInf(router, dummyOrthogID, cp);
+                    VertInf *cent = new (router)
+                            VertInf(router, dummyOrthogID, cp);
                     if (line1)
                     {
                         line1->vertInfs.insert(cent);
@@ -1995,9 +2059,9 @@ static void processEventHori(Router *router, NodeSet& scanline,
                         LineSegment(minLimit, maxLimit, lineX));
 
                 // Shape corners:
-                VertInf *vI1 = new VertInf(router, dummyOrthogShapeID, 
+                VertInf *vI1 = new (router) VertInf(router, dummyOrthogShapeID, 
                         Point(lineX, minShape));
-                VertInf *vI2 = new VertInf(router, dummyOrthogShapeID, 
+                VertInf *vI2 = new (router) VertInf(router, dummyOrthogShapeID, 
                         Point(lineX, maxShape));
                 line->vertInfs.insert(vI1);
                 line->vertInfs.insert(vI2);
@@ -2010,7 +2074,8 @@ static void processEventHori(Router *router, NodeSet& scanline,
                             LineSegment(minLimit, minLimitMax, lineX));
 
                     // Shape corner:
-                    VertInf *vI1 = new VertInf(router, dummyOrthogShapeID, 
+                    VertInf *vI1 = new (router)
+                            VertInf(router, dummyOrthogShapeID, 
                                 Point(lineX, minShape));
                     line->vertInfs.insert(vI1);
                 }
@@ -2020,7 +2085,8 @@ static void processEventHori(Router *router, NodeSet& scanline,
                             LineSegment(maxLimitMin, maxLimit, lineX));
 
                     // Shape corner:
-                    VertInf *vI2 = new VertInf(router, dummyOrthogShapeID, 
+                    VertInf *vI2 = new (router)
+                            VertInf(router, dummyOrthogShapeID, 
                                 Point(lineX, maxShape));
                     line->vertInfs.insert(vI2);
                 }
@@ -3038,7 +3104,8 @@ typedef std::list<ShiftSegment *> ShiftSegmentPtrList;
 
 
 static void nudgeOrthogonalRoutes(Router *router, size_t dimension, 
-        PtOrderMap& pointOrders, ShiftSegmentList& segmentList)
+        PtOrderMap& pointOrders, ShiftSegmentList& segmentList,
+        NudgingSolverStorage& storage)
 {
     bool nudgeFinalSegments = router->routingOption(
             nudgeOrthogonalSegmentsConnectedToShapes);
@@ -3049,6 +3116,8 @@ static void nudgeOrthogonalRoutes(Router *router, size_t dimension,
     double reductionSteps = 10.0;
     bool justCentring = pointOrders.empty();
 
+    router->timers.Count(ctNudgingSegments, segmentList.size());
+
     // Do the actual nudging.
     ShiftSegmentList currentRegion;
     while (!segmentList.empty())
@@ -3124,7 +3193,7 @@ static void nudgeOrthogonalRoutes(Router *router, size_t dimension,
             NudgingShiftSegment *currSegment = dynamic_cast<NudgingShiftSegment *> (*currSegmentIt);
             
             // Create a solver variable for the position of this segment.
-            currSegment->createSolverVariable();
+            currSegment->createSolverVariable(storage);
             
             if (justCentring)
             {
@@ -3207,7 +3276,7 @@ static void nudgeOrthogonalRoutes(Router *router, size_t dimension,
                         thisSepDist = 0;
                     }
                     
-                    Constraint *constraint = new Constraint(prevVar, 
+                    Constraint *constraint = storage.newConstraint(prevVar, 
                             vs[index], thisSepDist, equality);
                     cs.push_back(constraint);
                     if (thisSepDist)
@@ -3225,20 +3294,20 @@ static void nudgeOrthogonalRoutes(Router *router, size_t dimension,
                 // then constrain its placement as such.
                 if (currSegment->minSpaceLimit > -CHANNEL_MAX)
                 {
-                    vs.push_back(new Variable(fixedID,
+                    vs.push_back(storage.newVariable(fixedID,
                                 currSegment->minSpaceLimit, fixedWeight));
-                    cs.push_back(new Constraint(vs[vs.size() - 1], vs[index],
-                                0.0));
+                    cs.push_back(storage.newConstraint(vs[vs.size() - 1],
+                                vs[index], 0.0));
                 }
 
                 // If this segment sees a channel boundary to its right,
                 // then constrain its placement as such.
                 if (currSegment->maxSpaceLimit < CHANNEL_MAX)
                 {
-                    vs.push_back(new Variable(fixedID,
+                    vs.push_back(storage.newVariable(fixedID,
                                 currSegment->maxSpaceLimit, fixedWeight));
-                    cs.push_back(new Constraint(vs[index], vs[vs.size() - 1],
-                                0.0));
+                    cs.push_back(storage.newConstraint(vs[index],
+                                vs[vs.size() - 1], 0.0));
                 }
             }
 
@@ -3251,12 +3320,17 @@ static void nudgeOrthogonalRoutes(Router *router, size_t dimension,
         }
 #endif
         // Repeatedly try solving this with smaller separation distances till
-        // we find a solution that is satisfied.
+        // we find a solution that is satisfied.  Each attempt is solved 
+        // from scratch: a solver warm-started from the previous attempt's 
+        // blocks stops within its cost tolerance of the optimum, but with 
+        // the tiny weights used here that can leave segments more than a 
+        // unit away from where a fresh solve puts them.
         bool satisfied;
         do 
         {
             IncSolver f(vs,cs);
             f.solve();
+            router->timers.Count(ctVpscIterations, f.iterationCnt);
             satisfied = true;
             for (size_t i = 0; i < vs.size(); ++i) 
             {
@@ -3317,8 +3391,7 @@ static void nudgeOrthogonalRoutes(Router *router, size_t dimension,
         }
 #endif
         for_each(currentRegion.begin(), currentRegion.end(), delete_object());
-        for_each(vs.begin(), vs.end(), delete_object());
-        for_each(cs.begin(), cs.end(), delete_object());
+        storage.clear();
     }
 }
 
@@ -3404,6 +3477,8 @@ extern void improveOrthogonalRoutes(Router *router)
     // can be moved away from their original positions during nudging.
     buildConnectorRouteCheckpointCache(router);
 
+    NudgingSolverStorage storage;
+
     // Do centring first, by itself, to make nudging results a little better.
     // XXX This is still not great.  In some ways we really want to consider
     //     the ordering for all segments within a channel, rather than just
@@ -3417,7 +3492,8 @@ extern void improveOrthogonalRoutes(Router *router)
         ShiftSegmentList segmentList;
         buildOrthogonalNudgingSegments(router, dimension, segmentList);
         buildOrthogonalChannelInfo(router, dimension, segmentList);
-        nudgeOrthogonalRoutes(router, dimension, pointOrders, segmentList);
+        nudgeOrthogonalRoutes(router, dimension, pointOrders, segmentList,
+                storage);
     }
 
     // Do the nudging itself.
@@ -3433,7 +3509,8 @@ extern void improveOrthogonalRoutes(Router *router)
         ShiftSegmentList segmentList;
         buildOrthogonalNudgingSegments(router, dimension, segmentList);
         buildOrthogonalChannelInfo(router, dimension, segmentList);
-        nudgeOrthogonalRoutes(router, dimension, pointOrders, segmentList);
+        nudgeOrthogonalRoutes(router, dimension, pointOrders, segmentList,
+                storage);
     }
 
     // Resimplify all the display routes that may have been split.
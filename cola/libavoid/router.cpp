@@ -27,6 +27,13 @@
 #include <cmath>
 #include <cfloat>
 
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
+
 #include "libavoid/shape.h"
 #include "libavoid/router.h"
 #include "libavoid/visibility.h"
@@ -39,6 +46,8 @@
 #include "libavoid/assertions.h"
 #include "libavoid/connectionpin.h"
 #include "libavoid/makepath.h"
+#include "libavoid/bboxindex.h"
+#include "libavoid/blockpool.h"
 
 namespace Avoid {
 
@@ -191,6 +200,178 @@ class ActionInfo {
 };
 
 
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// The thread that runs a router's background transactions, the lock that
+// protects the state shared between it and the caller's thread, and the 
+// flag that tells it the current transaction has been superseded.
+//
+class AsyncTransactionWorker
+{
+    public:
+        AsyncTransactionWorker(Router *router)
+            : m_router(router),
+              m_joinable(false),
+              m_superseded(0)
+        {
+#ifdef _WIN32
+            InitializeCriticalSection(&m_mutex);
+#else
+            pthread_mutex_init(&m_mutex, NULL);
+#endif
+        }
+        ~AsyncTransactionWorker()
+        {
+            join();
+#ifdef _WIN32
+            DeleteCriticalSection(&m_mutex);
+#else
+            pthread_mutex_destroy(&m_mutex);
+#endif
+        }
+        void lock(void)
+        {
+#ifdef _WIN32
+            EnterCriticalSection(&m_mutex);
+#else
+            pthread_mutex_lock(&m_mutex);
+#endif
+        }
+        void unlock(void)
+        {
+#ifdef _WIN32
+            LeaveCriticalSection(&m_mutex);
+#else
+            pthread_mutex_unlock(&m_mutex);
+#endif
+        }
+        // The superseded flag is polled by the background thread while it
+        // routes, so it is read and written atomically rather than under
+        // the lock.
+        void setSuperseded(const bool superseded)
+        {
+#ifdef _WIN32
+            InterlockedExchange(&m_superseded, (superseded) ? 1 : 0);
+#else
+            __sync_lock_test_and_set(&m_superseded, (superseded) ? 1 : 0);
+            __sync_synchronize();
+#endif
+        }
+        bool superseded(void)
+        {
+#ifdef _WIN32
+            return InterlockedCompareExchange(&m_superseded, 0, 0) != 0;
+#else
+            return __sync_fetch_and_add(&m_superseded, 0) != 0;
+#endif
+        }
+        // Starts the thread.  Any previous thread must have been joined.
+        void start(void)
+        {
+            COLA_ASSERT(!m_joinable);
+            // The lock is held until the thread handle has been stored, so
+            // that the new thread can compare itself against it.
+            lock();
+#ifdef _WIN32
+            m_thread = CreateThread(NULL, 0, run, this, 0, &m_thread_id);
+            m_joinable = (m_thread != NULL);
+#else
+            m_joinable = (pthread_create(&m_thread, NULL, run, this) == 0);
+#endif
+            unlock();
+            if (!m_joinable)
+            {
+                // No thread, so process the transactions synchronously.
+                m_router->runAsyncTransactions();
+            }
+        }
+        void join(void)
+        {
+            if (!m_joinable)
+            {
+                return;
+            }
+#ifdef _WIN32
+            WaitForSingleObject(m_thread, INFINITE);
+            CloseHandle(m_thread);
+#else
+            pthread_join(m_thread, NULL);
+#endif
+            m_joinable = false;
+        }
+        // Returns whether this is called on the background thread, which
+        // must not wait for itself to finish.
+        bool calledFromThread(void)
+        {
+            lock();
+#ifdef _WIN32
+            bool fromThread = m_joinable &&
+                    (GetCurrentThreadId() == m_thread_id);
+#else
+            bool fromThread = m_joinable &&
+                    pthread_equal(m_thread, pthread_self());
+#endif
+            unlock();
+            return fromThread;
+        }
+
+    private:
+#ifdef _WIN32
+        static DWORD WINAPI run(LPVOID worker)
+        {
+            ((AsyncTransactionWorker *) worker)->m_router->
+                    runAsyncTransactions();
+            return 0;
+        }
+        CRITICAL_SECTION m_mutex;
+        HANDLE m_thread;
+        DWORD m_thread_id;
+#else
+        static void *run(void *worker)
+        {
+            ((AsyncTransactionWorker *) worker)->m_router->
+                    runAsyncTransactions();
+            return NULL;
+        }
+        pthread_mutex_t m_mutex;
+        pthread_t m_thread;
+#endif
+        Router *m_router;
+        bool m_joinable;
+#ifdef _WIN32
+        volatile LONG m_superseded;
+#else
+        volatile int m_superseded;
+#endif
+};
+
+
+// Holds a background transaction worker's lock, if the router has a worker,
+// for the lifetime of this object.
+class AsyncTransactionLock
+{
+    public:
+        AsyncTransactionLock(AsyncTransactionWorker *worker)
+            : m_worker(worker)
+        {
+            if (m_worker)
+            {
+                m_worker->lock();
+            }
+        }
+        ~AsyncTransactionLock()
+        {
+            if (m_worker)
+            {
+                m_worker->unlock();
+            }
+        }
+
+    private:
+        AsyncTransactionWorker *m_worker;
+};
+
+
 Router::Router(const unsigned int flags)
     : visOrthogGraph(true),
       PartialTime(false),
@@ -213,7 +394,20 @@ Router::Router(const unsigned int flags)
       m_consolidate_actions(true),
       m_currently_calling_destructors(false),
       m_orthogonal_nudge_distance(4.0),
+      m_obstacle_bbox_index(new ObstacleBBoxIndex()),
+      m_cluster_bbox_index(new ClusterBBoxIndex()),
+      m_edge_pool(new BlockPool(sizeof(EdgeInf))),
+      m_poly_line_state_pool(new BlockPool(sizeof(EdgeInf::PolyLineState))),
+      m_orthogonal_edge_arena(new BlockPool(sizeof(EdgeInf))),
+      m_orthogonal_vertex_arena(new BlockPool(sizeof(VertInf))),
+      m_route_cache_epoch(0),
       m_slow_routing_callback(NULL),
+      m_transaction_budgeted(false),
+      m_transaction_deadline(0),
+      m_defer_refinement(false),
+      m_refinement_pending(false),
+      m_async_worker(NULL),
+      m_async_transaction_running(false),
       // Mode options:
       m_allows_polyline_routing(false),
       m_allows_orthogonal_routing(false),
@@ -244,6 +438,10 @@ Router::Router(const unsigned int flags)
     m_routing_options[improveHyperedgeRoutesMovingJunctions] = true;
     m_routing_options[penaliseOrthogonalSharedPathsAtConnEnds] = false;
     m_routing_options[nudgeOrthogonalTouchingColinearSegments] = false;
+    m_routing_options[useLandmarkHeuristicForOrthogonalRouting] = false;
+    m_routing_options[cacheOrthogonalRoutesOfUnaffectedConnectors] = false;
+    m_routing_options[useRadixHeapForOrthogonalRouting] = false;
+    m_routing_options[computeHyperedgeTreesConcurrently] = false;
 
     m_hyperedge_rerouter.setRouter(this);
 }
@@ -251,6 +449,10 @@ Router::Router(const unsigned int flags)
 
 Router::~Router()
 {
+    // Finish and remove the background thread, if any.
+    delete m_async_worker;
+    m_async_worker = NULL;
+
     m_currently_calling_destructors = true;
 
     // Delete remaining connectors.
@@ -286,12 +488,20 @@ Router::~Router()
     COLA_ASSERT(m_obstacles.size() == 0);
     COLA_ASSERT(connRefs.size() == 0);
     COLA_ASSERT(visGraph.size() == 0);
+
+    delete m_obstacle_bbox_index;
+    delete m_cluster_bbox_index;
+    delete m_edge_pool;
+    delete m_poly_line_state_pool;
+    delete m_orthogonal_edge_arena;
+    delete m_orthogonal_vertex_arena;
 }
 
 
 void Router::modifyConnector(ConnRef *conn, const unsigned int type,
         const ConnEnd& connEnd, bool connPinMoveUpdate)
 {
+    waitForAsyncTransactions();
     ActionInfo modInfo(ConnChange, conn);
     
     ActionInfoList::iterator found = 
@@ -317,6 +527,7 @@ void Router::modifyConnector(ConnRef *conn, const unsigned int type,
 
 void Router::modifyConnector(ConnRef *conn)
 {
+    waitForAsyncTransactions();
     ActionInfo modInfo(ConnChange, conn);
     
     ActionInfoList::iterator found = 
@@ -335,6 +546,7 @@ void Router::modifyConnector(ConnRef *conn)
 
 void Router::modifyConnectionPin(ShapeConnectionPin *pin)
 {
+    waitForAsyncTransactions();
     ActionInfo modInfo(ConnectionPinChange, pin);
     
     ActionInfoList::iterator found = 
@@ -353,6 +565,7 @@ void Router::modifyConnectionPin(ShapeConnectionPin *pin)
 
 void Router::removeObjectFromQueuedActions(const void *object)
 {
+    waitForAsyncTransactions();
     for (ActionInfoList::iterator curr = actionList.begin();
             curr != actionList.end(); )
     {
@@ -370,6 +583,8 @@ void Router::removeObjectFromQueuedActions(const void *object)
 
 void Router::addShape(ShapeRef *shape)
 {
+    waitForAsyncTransactions();
+
     // There shouldn't be remove events or move events for the same shape
     // already in the action list.
     // XXX: Possibly we could handle this by ordering them intelligently.
@@ -396,6 +611,8 @@ void Router::addShape(ShapeRef *shape)
 
 void Router::deleteShape(ShapeRef *shape)
 {
+    waitForAsyncTransactions();
+
     // There shouldn't be add events events for the same shape already 
     // in the action list.
     // XXX: Possibly we could handle this by ordering them intelligently.
@@ -427,6 +644,7 @@ void Router::deleteShape(ShapeRef *shape)
 
 void Router::deleteConnector(ConnRef *connector)
 {
+    waitForAsyncTransactions();
     m_currently_calling_destructors = true;
     delete connector;
     m_currently_calling_destructors = false;
@@ -434,6 +652,8 @@ void Router::deleteConnector(ConnRef *connector)
 
 void Router::moveShape(ShapeRef *shape, const double xDiff, const double yDiff)
 {
+    // The shape's current polygon is changed by background transactions.
+    waitForAsyncTransactions();
     Polygon newPoly = shape->polygon();
     newPoly.translate(xDiff, yDiff);
 
@@ -444,37 +664,49 @@ void Router::moveShape(ShapeRef *shape, const double xDiff, const double yDiff)
 void Router::moveShape(ShapeRef *shape, const Polygon& newPoly, 
         const bool first_move)
 {
-    // There shouldn't be remove events or add events for the same shape
-    // already in the action list.
-    // XXX: Possibly we could handle this by ordering them intelligently.
-    COLA_ASSERT(find(actionList.begin(), actionList.end(), 
-                ActionInfo(ShapeRemove, shape)) == actionList.end());
-    
-    ActionInfoList::iterator found = find(actionList.begin(), 
-            actionList.end(), ActionInfo(ShapeAdd, shape));
-    if (found != actionList.end())
     {
-        // The Add is enough, no need for the Move action too.
-        // The shape will be added with it's existing polygon,
-        // so set this to be the newPoly passed for the move.
-        found->shape()->setNewPoly(newPoly);
-        return;
-    }
+        AsyncTransactionLock lock(m_async_worker);
+        // While a background transaction is running, queue the move for the
+        // one after it.
+        ActionInfoList& queue = (m_async_transaction_running) ?
+                m_async_queued_actions : actionList;
+        if (m_async_transaction_running)
+        {
+            m_async_worker->setSuperseded(true);
+        }
+
+        // There shouldn't be remove events or add events for the same shape
+        // already in the action list.
+        // XXX: Possibly we could handle this by ordering them intelligently.
+        COLA_ASSERT(find(queue.begin(), queue.end(), 
+                    ActionInfo(ShapeRemove, shape)) == queue.end());
+    
+        ActionInfoList::iterator found = find(queue.begin(), 
+                queue.end(), ActionInfo(ShapeAdd, shape));
+        if (found != queue.end())
+        {
+            // The Add is enough, no need for the Move action too.
+            // The shape will be added with it's existing polygon,
+            // so set this to be the newPoly passed for the move.
+            found->shape()->setNewPoly(newPoly);
+            return;
+        }
 
-    ActionInfo moveInfo(ShapeMove, shape, newPoly, first_move);
-    // Sanely cope with the case where the user requests moving the same
-    // shape multiple times before rerouting connectors.
-    found = find(actionList.begin(), actionList.end(), moveInfo);
+        ActionInfo moveInfo(ShapeMove, shape, newPoly, first_move);
+        // Sanely cope with the case where the user requests moving the same
+        // shape multiple times before rerouting connectors.
+        found = find(queue.begin(), queue.end(), moveInfo);
 
-    if (found != actionList.end())
-    {
-        // Just update the ActionInfo with the second polygon, but
-        // leave the firstMove setting alone.
-        found->newPoly = newPoly;
-    }
-    else 
-    {
-        actionList.push_back(moveInfo);
+        if (found != queue.end())
+        {
+            // Just update the ActionInfo with the second polygon, but
+            // leave the firstMove setting alone.
+            found->newPoly = newPoly;
+        }
+        else 
+        {
+            queue.push_back(moveInfo);
+        }
     }
 
     if (!m_consolidate_actions)
@@ -492,25 +724,38 @@ void Router::setStaticGraphInvalidated(const bool invalidated)
 
 void Router::destroyOrthogonalVisGraph(void)
 {
-    // Remove orthogonal visibility graph edges.
-    visOrthogGraph.clear();
+    // Orthogonal edges live in their own arena, so rather than making 
+    // each one inactive and deleting it, we just forget them and detach
+    // them from the vertices they join.  Their storage is reclaimed below.
+    visOrthogGraph.forgetEdges();
+    m_astar_landmarks.invalidate();
 
-    // Remove the now orphaned vertices.
-    VertInf *curr = vertices.shapesBegin();
+    // Remove the dummy vertices, which are all now orphaned.
+    VertInf *curr = vertices.connsBegin();
     while (curr)
     {
-        if (curr->orphaned() && (curr->id == dummyOrthogID))
+        curr->orthogVisList.clear();
+        curr->orthogVisListSize = 0;
+        if (curr->id == dummyOrthogID)
         {
+            COLA_ASSERT(curr->orphaned());
             VertInf *following = vertices.removeVertex(curr);
-            delete curr;
+            curr->~VertInf();
             curr = following;
             continue;
         }
         curr = curr->lstNext;
     }
+
+    m_orthogonal_edge_arena->reset();
+    m_orthogonal_vertex_arena->reset();
 }
 
 
+// The number of landmarks used for the A* landmark heuristic.
+static const size_t orthogonalLandmarkCount = 4;
+
+
 void Router::regenerateStaticBuiltGraph(void)
 {
     // Here we do talks involved in updating the static-built visibility 
@@ -526,6 +771,11 @@ void Router::regenerateStaticBuiltGraph(void)
             generateStaticOrthogonalVisGraph(this);
             
             timers.Stop();
+
+            if (routingOption(useLandmarkHeuristicForOrthogonalRouting))
+            {
+                m_astar_landmarks.compute(this, orthogonalLandmarkCount);
+            }
         }
         m_static_orthogonal_graph_invalidated = false;
     }
@@ -540,11 +790,140 @@ bool Router::transactionUse(void) const
 
 void Router::setTransactionUse(const bool transactions)
 {
+    waitForAsyncTransactions();
     m_consolidate_actions = transactions;
 }
 
 
 bool Router::processTransaction(void)
+{
+    // The background thread owns the router's objects while it runs.
+    waitForAsyncTransactions();
+    return processQueuedActions();
+}
+
+
+bool Router::processTransaction(const unsigned int timeBudget)
+{
+    waitForAsyncTransactions();
+    m_transaction_budgeted = true;
+    m_transaction_deadline = Timer::Now() + 
+            ((bigclock_t) timeBudget * 1000000);
+    bool processed = processQueuedActions();
+    m_transaction_budgeted = false;
+    return processed;
+}
+
+
+bool Router::refinementPending(void) const
+{
+    return m_refinement_pending;
+}
+
+
+bool Router::transactionBudgetExhausted(void) const
+{
+    return transactionSuperseded() || (m_transaction_budgeted && 
+            (Timer::Now() >= m_transaction_deadline));
+}
+
+
+bool Router::transactionSuperseded(void) const
+{
+    return m_async_worker && m_async_worker->superseded();
+}
+
+
+void Router::processTransactionAsync(void)
+{
+    if (m_async_worker == NULL)
+    {
+        m_async_worker = new AsyncTransactionWorker(this);
+    }
+    {
+        AsyncTransactionLock lock(m_async_worker);
+        if (m_async_transaction_running)
+        {
+            // The background thread will pick up the queued moves.
+            return;
+        }
+        m_async_transaction_running = true;
+        m_async_worker->setSuperseded(false);
+    }
+    // The previous thread, if any, has finished.
+    m_async_worker->join();
+    m_async_worker->start();
+}
+
+
+bool Router::asyncTransactionInProgress(void) const
+{
+    AsyncTransactionLock lock(m_async_worker);
+    return m_async_transaction_running;
+}
+
+
+void Router::waitForAsyncTransactions(void)
+{
+    // Changes made by the background transaction itself, such as the new
+    // junctions and connectors of rerouted hyperedges, go ahead.
+    if (m_async_worker && !m_async_worker->calledFromThread())
+    {
+        m_async_worker->join();
+    }
+}
+
+
+bool Router::completedRoute(const ConnRef *conn, Polygon& route) const
+{
+    AsyncTransactionLock lock(m_async_worker);
+    std::map<unsigned int, Polygon>::const_iterator found = 
+            m_completed_routes.find(conn->id());
+    if (found == m_completed_routes.end())
+    {
+        return false;
+    }
+    route = found->second;
+    return true;
+}
+
+
+// Runs on the background thread.  Processes the queued actions, then any
+// moves queued in the meantime, until no more are queued.
+void Router::runAsyncTransactions(void)
+{
+    while (true)
+    {
+        processQueuedActions();
+        publishCompletedRoutes();
+
+        AsyncTransactionLock lock(m_async_worker);
+        if (m_async_queued_actions.empty())
+        {
+            m_async_transaction_running = false;
+            return;
+        }
+        actionList.splice(actionList.end(), m_async_queued_actions);
+        m_async_worker->setSuperseded(false);
+    }
+}
+
+
+void Router::publishCompletedRoutes(void)
+{
+    std::map<unsigned int, Polygon> routes;
+    ConnRefList::const_iterator fin = connRefs.end();
+    for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
+    {
+        routes[(*i)->id()] = (*i)->displayRoute();
+    }
+
+    AsyncTransactionLock lock(m_async_worker);
+    m_completed_routes.swap(routes);
+}
+
+
+bool Router::processQueuedActions(void)
 {
     bool notPartialTime = !(PartialFeedback && PartialTime);
     bool seenShapeMovesOrDeletes = false;
@@ -552,14 +931,22 @@ bool Router::processTransaction(void)
     m_transaction_start_time = clock();
     m_abort_transaction = false;
 
+    bool hasChanges = !actionList.empty() || 
+            (m_hyperedge_rerouter.count() > 0);
+
     // If SimpleRouting, then don't update here.
-    if ((actionList.empty() && (m_hyperedge_rerouter.count() == 0)) ||
-            SimpleRouting)
+    if ((!hasChanges && !m_refinement_pending) || SimpleRouting)
     {
         actionList.clear();
         return false;
     }
 
+    // A budgeted transaction with changes to process just reroutes the
+    // connectors, leaving refinement for a later call.
+    m_defer_refinement = m_transaction_budgeted && hasChanges;
+
+    timers.ResetTransaction();
+
     actionList.sort();
     ActionInfoList::iterator curr;
     ActionInfoList::iterator finish = actionList.end();
@@ -583,6 +970,9 @@ bool Router::processTransaction(void)
 
         unsigned int pid = obstacle->id();
 
+        // Routes searched through the old position may now be different.
+        addChangedRegion(obstacle->polygon());
+
         // o  Remove entries related to this shape's vertices
         obstacle->removeFromGraph();
         
@@ -682,6 +1072,7 @@ bool Router::processTransaction(void)
         }
         const Polygon& shapePoly = obstacle->polygon();
 
+        addChangedRegion(shapePoly);
         adjustContainsWithAdd(shapePoly, pid);
 
         if (m_allows_polyline_routing)
@@ -710,28 +1101,57 @@ bool Router::processTransaction(void)
     for (curr = actionList.begin(); curr != finish; ++curr)
     {
         ActionInfo& actInf = *curr;
+        if (actInf.type == ConnectionPinChange)
+        {
+            // Pins offer new routes to any connector attached to the 
+            // shape, so no existing routes can be reused.
+            ++m_route_cache_epoch;
+            continue;
+        }
         if (actInf.type != ConnChange)
         {
             continue;
         }
+        ConnRef *connRef = actInf.conn();
         for (ConnUpdateList::iterator conn = actInf.conns.begin();
                 conn != actInf.conns.end(); ++conn)
         {
-            actInf.conn()->updateEndPoint(conn->first, conn->second);
+            VertInf *oldEnd = (conn->first == VertID::src) ?
+                    connRef->m_src_vert : connRef->m_dst_vert;
+            if (oldEnd)
+            {
+                addChangedRegion(oldEnd->point);
+            }
+            connRef->updateEndPoint(conn->first, conn->second);
+            VertInf *newEnd = (conn->first == VertID::src) ?
+                    connRef->m_src_vert : connRef->m_dst_vert;
+            if (newEnd)
+            {
+                addChangedRegion(newEnd->point);
+            }
         }
     }
     // Clear the actionList.
     actionList.clear();
     
-    m_static_orthogonal_graph_invalidated = true;
+    if (hasChanges)
+    {
+        m_static_orthogonal_graph_invalidated = true;
+    }
     rerouteAndCallbackConnectors();
 
+    // The A* node storage is only reused within a transaction.
+    timers.Count(ctAStarBytesAllocated,
+            (unsigned int) m_astar_node_pool.bytesAllocated());
+    m_astar_node_pool.release();
+
     return true;
 }
 
 
 void Router::addJunction(JunctionRef *junction)
 {
+    waitForAsyncTransactions();
     // There shouldn't be remove events or move events for the same junction
     // already in the action list.
     // XXX: Possibly we could handle this by ordering them intelligently.
@@ -758,6 +1178,7 @@ void Router::addJunction(JunctionRef *junction)
 
 void Router::deleteJunction(JunctionRef *junction)
 {
+    waitForAsyncTransactions();
     // There shouldn't be add events events for the same junction already 
     // in the action list.
     // XXX: Possibly we could handle this by ordering them intelligently.
@@ -790,6 +1211,8 @@ void Router::deleteJunction(JunctionRef *junction)
 void Router::moveJunction(JunctionRef *junction, const double xDiff, 
         const double yDiff)
 {
+    // The junction's current position is changed by background transactions.
+    waitForAsyncTransactions();
     Point newPosition = junction->position();
     newPosition.x += xDiff;
     newPosition.y += yDiff;
@@ -800,35 +1223,47 @@ void Router::moveJunction(JunctionRef *junction, const double xDiff,
 
 void Router::moveJunction(JunctionRef *junction, const Point& newPosition)
 {
-    // There shouldn't be remove events or add events for the same junction
-    // already in the action list.
-    // XXX: Possibly we could handle this by ordering them intelligently.
-    COLA_ASSERT(find(actionList.begin(), actionList.end(), 
-                ActionInfo(JunctionRemove, junction)) == actionList.end());
-    
-    ActionInfoList::iterator found = find(actionList.begin(), 
-            actionList.end(), ActionInfo(JunctionAdd, junction));
-    if (found != actionList.end())
     {
-        // The Add is enough, no need for the Move action too.
-        // The junction will be added with the new position.
-        found->junction()->setPosition(newPosition);
-        return;
-    }
+        AsyncTransactionLock lock(m_async_worker);
+        // While a background transaction is running, queue the move for the
+        // one after it.
+        ActionInfoList& queue = (m_async_transaction_running) ?
+                m_async_queued_actions : actionList;
+        if (m_async_transaction_running)
+        {
+            m_async_worker->setSuperseded(true);
+        }
 
-    ActionInfo moveInfo(JunctionMove, junction, newPosition);
-    // Sanely cope with the case where the user requests moving the same
-    // shape multiple times before rerouting connectors.
-    found = find(actionList.begin(), actionList.end(), moveInfo);
+        // There shouldn't be remove events or add events for the same junction
+        // already in the action list.
+        // XXX: Possibly we could handle this by ordering them intelligently.
+        COLA_ASSERT(find(queue.begin(), queue.end(), 
+                    ActionInfo(JunctionRemove, junction)) == queue.end());
+    
+        ActionInfoList::iterator found = find(queue.begin(), 
+                queue.end(), ActionInfo(JunctionAdd, junction));
+        if (found != queue.end())
+        {
+            // The Add is enough, no need for the Move action too.
+            // The junction will be added with the new position.
+            found->junction()->setPosition(newPosition);
+            return;
+        }
 
-    if (found != actionList.end())
-    {
-        // Just update the ActionInfo with the second position.
-        found->newPosition = newPosition;
-    }
-    else 
-    {
-        actionList.push_back(moveInfo);
+        ActionInfo moveInfo(JunctionMove, junction, newPosition);
+        // Sanely cope with the case where the user requests moving the same
+        // shape multiple times before rerouting connectors.
+        found = find(queue.begin(), queue.end(), moveInfo);
+
+        if (found != queue.end())
+        {
+            // Just update the ActionInfo with the second position.
+            found->newPosition = newPosition;
+        }
+        else 
+        {
+            queue.push_back(moveInfo);
+        }
     }
 
     if (!m_consolidate_actions)
@@ -839,27 +1274,35 @@ void Router::moveJunction(JunctionRef *junction, const Point& newPosition)
 
 void Router::addCluster(ClusterRef *cluster)
 {
+    waitForAsyncTransactions();
     cluster->makeActive();
     
     unsigned int pid = cluster->id();
     ReferencingPolygon& poly = cluster->polygon();
 
     adjustClustersWithAdd(poly, pid);
+
+    // Cluster crossing costs apply to all routes.
+    ++m_route_cache_epoch;
 }
 
 
 void Router::deleteCluster(ClusterRef *cluster)
 {
+    waitForAsyncTransactions();
     cluster->makeInactive();
     
     unsigned int pid = cluster->id();
     
     adjustClustersWithDel(pid);
+
+    ++m_route_cache_epoch;
 }
 
 
 void Router::setOrthogonalNudgeDistance(const double dist)
 {
+    waitForAsyncTransactions();
     COLA_ASSERT(dist >= 0);
     m_orthogonal_nudge_distance = dist;
 }
@@ -879,6 +1322,10 @@ unsigned int Router::newObjectId(void) const
 
 unsigned int Router::assignId(const unsigned int suggestedId)
 {
+    // Every new shape, junction, cluster and connector is given an ID, so
+    // this is where their construction waits for background transactions.
+    waitForAsyncTransactions();
+
     // If the suggestedId is zero, then we assign the object the next
     // smallest unassigned ID, otherwise we trust the ID given is unique.
     unsigned int assignedId = (suggestedId == 0) ?  newObjectId() : suggestedId;
@@ -997,6 +1444,7 @@ void Router::attachedShapes(IntList &shapes, const unsigned int shapeId,
 void Router::rerouteAndCallbackConnectors(void)
 {
     ConnRefList reroutedConns;
+    bool routingDeferred = false;
     ConnRefList::const_iterator fin = connRefs.end();
     
     this->m_conn_reroute_flags.alertConns();
@@ -1004,16 +1452,43 @@ void Router::rerouteAndCallbackConnectors(void)
     // Updating the orthogonal visibility graph if necessary. 
     regenerateStaticBuiltGraph();
 
-    for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
-    {
-        (*i)->freeActivePins();
-    }
-
     // Calculate and return connectors that are part of hyperedges and will
     // be completely rerouted by that code so don't need to be rerouted here.
     ConnRefSet hyperedgeConns =
             m_hyperedge_rerouter.calcHyperedgeConnectors();
 
+    // Find connectors whose previous route searches didn't touch anything
+    // changed in this transaction.  These keep their routes and their 
+    // active pins.  Their nudged routes are remembered so they can be 
+    // alerted if nudging moves them.
+    ConnRefSet cachedConns;
+    std::vector<std::pair<ConnRef *, Polygon> > cachedDisplayRoutes;
+    for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
+    {
+        if ((hyperedgeConns.find(*i) == hyperedgeConns.end()) &&
+                connectorSearchRegionUnchanged(*i))
+        {
+            cachedConns.insert(*i);
+            cachedDisplayRoutes.push_back(
+                    std::make_pair(*i, (*i)->m_display_route));
+            // Nudge from the unimproved route, as if just rerouted.
+            (*i)->m_display_route.clear();
+            (*i)->m_needs_repaint = false;
+            if (!cachedOrthogonalRoutesAreFinal())
+            {
+                // The route is just kept for this budgeted transaction,
+                // so reroute the connector when refining.
+                (*i)->m_needs_reroute_flag = true;
+            }
+            timers.Count(ctRouteCacheHits);
+        }
+        else
+        {
+            (*i)->freeActivePins();
+        }
+    }
+    m_changed_regions.clear();
+
     timers.Register(tmOrthogRoute, timerStart);
     for (ConnRefList::const_iterator i = connRefs.begin(); i != fin; ++i) 
     {
@@ -1022,6 +1497,24 @@ void Router::rerouteAndCallbackConnectors(void)
             // This will be rerouted by the hyperedge code, so do nothing.
             continue;
         }
+        if (cachedConns.find(*i) != cachedConns.end())
+        {
+            // The existing route is still valid.
+            continue;
+        }
+
+        if (((*i)->m_false_path || (*i)->m_needs_reroute_flag) &&
+                !(*i)->m_route.empty() && !(*i)->m_endpoint_moved &&
+                transactionBudgetExhausted())
+        {
+            // Out of time.  Keep the existing route for now and reroute 
+            // this connector on the next call.  Connectors with moved 
+            // endpoints are always rerouted, since their existing routes 
+            // no longer reach their ends.
+            (*i)->m_needs_reroute_flag = true;
+            routingDeferred = true;
+            continue;
+        }
 
         (*i)->m_needs_repaint = false;
         bool rerouted = (*i)->generatePath();
@@ -1036,16 +1529,42 @@ void Router::rerouteAndCallbackConnectors(void)
     // Perform any complete hyperedge rerouting that has been requested.
     m_hyperedge_rerouter.performRerouting();
 
-    // Find and reroute crossing connectors if crossing penalties are set.
-    improveCrossings();
-
-    if (routingOption(improveHyperedgeRoutesMovingJunctions))
+    m_refinement_pending = m_defer_refinement || routingDeferred ||
+            transactionSuperseded();
+    if (m_refinement_pending)
     {
-        improveHyperedgeRoutes(this);
+        // Connectors that kept their routes keep their previous nudged
+        // routes until refinement is performed.
+        for (size_t i = 0; i < cachedDisplayRoutes.size(); ++i)
+        {
+            cachedDisplayRoutes[i].first->m_display_route =
+                    cachedDisplayRoutes[i].second;
+        }
+    }
+    else
+    {
+        // Find and reroute crossing connectors if crossing penalties are set.
+        improveCrossings();
+
+        if (routingOption(improveHyperedgeRoutesMovingJunctions))
+        {
+            improveHyperedgeRoutes(this);
+        }
+
+        // Perform centring and nudging for orthogonal routes.
+        improveOrthogonalRoutes(this);
     }
 
-    // Perform centring and nudging for orthogonal routes.
-    improveOrthogonalRoutes(this);
+    // Connectors that kept their routes only need redrawing if their
+    // final routes have changed.
+    for (size_t i = 0; i < cachedDisplayRoutes.size(); ++i)
+    {
+        ConnRef *conn = cachedDisplayRoutes[i].first;
+        if (conn->displayRoute().ps != cachedDisplayRoutes[i].second.ps)
+        {
+            reroutedConns.push_back(conn);
+        }
+    }
 
     // Alert connectors that they need redrawing.
     fin = reroutedConns.end();
@@ -1056,6 +1575,102 @@ void Router::rerouteAndCallbackConnectors(void)
     }
 }
 
+// A change to an obstacle or connector endpoint alters the orthogonal 
+// visibility graph not only where it lies but along the scanlines through 
+// it, which run horizontally and vertically until they meet other 
+// obstacles.  Removing an obstacle can also let another scanline run on 
+// past where it was, but such a scanline lies within the obstacle's 
+// vertical or horizontal extent.  So the regions recorded are the 
+// full-width and full-height strips through the changed area, and a route
+// whose bends sit on a vertex that such a change removes is not reused.
+void Router::addChangedRegion(const BBox& changed)
+{
+    BBox region = changed;
+    region.a.x = -DBL_MAX;
+    region.b.x = DBL_MAX;
+    m_changed_regions.push_back(region);
+
+    region = changed;
+    region.a.y = -DBL_MAX;
+    region.b.y = DBL_MAX;
+    m_changed_regions.push_back(region);
+}
+
+
+void Router::addChangedRegion(const Polygon& poly)
+{
+    BBox region;
+    poly.getBoundingRect(&region.a.x, &region.a.y, &region.b.x, &region.b.y);
+    addChangedRegion(region);
+}
+
+
+void Router::addChangedRegion(const Point& point)
+{
+    BBox region;
+    region.a = point;
+    region.b = point;
+    addChangedRegion(region);
+}
+
+
+// Returns true if the connector has an orthogonal route found by searches
+// that explored only parts of the visibility graph unaffected by changes in
+// this transaction, meaning the search would find the same route again.
+bool Router::connectorSearchRegionUnchanged(const ConnRef *conn) const
+{
+    if (conn->routingType() != ConnType_Orthogonal)
+    {
+        return false;
+    }
+    if (!m_defer_refinement && !cachedOrthogonalRoutesAreFinal())
+    {
+        // Only a transaction deferring refinement keeps these routes, and
+        // then only until the refinement reroutes them.
+        return false;
+    }
+    if (!conn->m_false_path || conn->m_needs_reroute_flag || 
+            conn->m_route.empty() || !conn->m_search_region_valid ||
+            (conn->m_search_region_epoch != m_route_cache_epoch))
+    {
+        return false;
+    }
+    if (routingOption(improveHyperedgeRoutesMovingJunctions))
+    {
+        // Junction positions may be changed by hyperedge improvement.
+        std::pair<Obstacle *, Obstacle *> anchors = conn->endpointAnchors();
+        if (dynamic_cast<JunctionRef *> (anchors.first) ||
+                dynamic_cast<JunctionRef *> (anchors.second))
+        {
+            return false;
+        }
+    }
+
+    const BBox& searched = conn->m_search_region;
+    for (size_t i = 0; i < m_changed_regions.size(); ++i)
+    {
+        const BBox& changed = m_changed_regions[i];
+        if ((changed.a.x <= searched.b.x) && (changed.b.x >= searched.a.x) &&
+                (changed.a.y <= searched.b.y) && (changed.b.y >= searched.a.y))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Returns true if a route kept because its search region is unchanged is
+// the route a new search would find.  This is not so when routing doesn't
+// cache routes, or when crossing or shared path penalties make routes
+// depend on the routes of other connectors.
+bool Router::cachedOrthogonalRoutesAreFinal(void) const
+{
+    return routingOption(cacheOrthogonalRoutesOfUnaffectedConnectors) &&
+            (routingParameter(crossingPenalty) == 0) &&
+            (routingParameter(fixedSharedPathPenalty) == 0);
+}
+
 // Type holding a cost estimate and ConnRef.
 typedef std::pair<double, ConnRef *> ConnCostRef;
 
@@ -1188,6 +1803,12 @@ void Router::performSlowRoutingCallBack(double completeFraction)
             m_abort_transaction = true;
         }
     }
+    if (transactionBudgetExhausted())
+    {
+        // Out of time, so continue without penalties.
+        m_in_crossing_rerouting_stage = false;
+        m_abort_transaction = true;
+    }
 }
 
 
@@ -1497,42 +2118,70 @@ void Router::checkAllMissingEdges(void)
 
 void Router::generateContains(VertInf *pt)
 {
-    contains[pt->id].clear();
-    enclosingClusters[pt->id].clear();
+    ShapeSet& ptContains = contains[pt->id];
+    ShapeSet& ptEnclosingClusters = enclosingClusters[pt->id];
+    ptContains.clear();
+    ptEnclosingClusters.clear();
 
     // Don't count points on the border as being inside.
     bool countBorder = false;
 
-    // Compute enclosing shapes.
-    ObstacleList::const_iterator finish = m_obstacles.end();
-    for (ObstacleList::const_iterator i = m_obstacles.begin(); i != finish; ++i)
+    // Compute enclosing shapes.  Only obstacles whose bounding box
+    // contains the point need to be tested.
+    if (!m_obstacle_bbox_index->isValid())
+    {
+        m_obstacle_bbox_index->rebuild(m_obstacles.begin(), m_obstacles.end());
+    }
+    std::vector<Obstacle *> obstacleCandidates;
+    m_obstacle_bbox_index->candidatesContaining(pt->point, obstacleCandidates);
+    for (size_t i = 0; i < obstacleCandidates.size(); ++i)
     {
-        if (inPoly((*i)->polygon(), pt->point, countBorder))
+        Obstacle *obstacle = obstacleCandidates[i];
+        if (inPoly(obstacle->polygon(), pt->point, countBorder))
         {
-            contains[pt->id].insert((*i)->id());
+            ptContains.insert(obstacle->id());
         }
     }
 
     // Computer enclosing Clusters
-    ClusterRefList::const_iterator clFinish = clusterRefs.end();
-    for (ClusterRefList::const_iterator i = clusterRefs.begin(); 
-            i != clFinish; ++i)
+    if (!m_cluster_bbox_index->isValid())
+    {
+        m_cluster_bbox_index->rebuild(clusterRefs.begin(), clusterRefs.end());
+    }
+    std::vector<ClusterRef *> clusterCandidates;
+    m_cluster_bbox_index->candidatesContaining(pt->point, clusterCandidates);
+    for (size_t i = 0; i < clusterCandidates.size(); ++i)
     {
-        if (inPolyGen((*i)->polygon(), pt->point))
+        ClusterRef *cluster = clusterCandidates[i];
+        if (inPolyGen(cluster->polygon(), pt->point))
         {
-            enclosingClusters[pt->id].insert((*i)->id());
+            ptEnclosingClusters.insert(cluster->id());
         }
     }
 }
 
 
+// Returns true if the point lies inside or on the border of the given 
+// bounding rectangle.
+static inline bool inBoundingRect(const Point& point, const double minX, 
+        const double minY, const double maxX, const double maxY)
+{
+    return (point.x >= minX) && (point.x <= maxX) && 
+            (point.y >= minY) && (point.y <= maxY);
+}
+
+
 void Router::adjustClustersWithAdd(const PolygonInterface& poly, 
         const int p_cluster)
 {
+    double minX, minY, maxX, maxY;
+    poly.getBoundingRect(&minX, &minY, &maxX, &maxY);
+
     for (VertInf *k = vertices.connsBegin(); k != vertices.shapesBegin();
             k = k->lstNext)
     {
-        if (inPolyGen(poly, k->point))
+        if (inBoundingRect(k->point, minX, minY, maxX, maxY) &&
+                inPolyGen(poly, k->point))
         {
             enclosingClusters[k->id].insert(p_cluster);
         }
@@ -1555,10 +2204,14 @@ void Router::adjustContainsWithAdd(const Polygon& poly, const int p_shape)
     // Don't count points on the border as being inside.
     bool countBorder = false;
 
+    double minX, minY, maxX, maxY;
+    poly.getBoundingRect(&minX, &minY, &maxX, &maxY);
+
     for (VertInf *k = vertices.connsBegin(); k != vertices.shapesBegin();
             k = k->lstNext)
     {
-        if (inPoly(poly, k->point, countBorder))
+        if (inBoundingRect(k->point, minX, minY, maxX, maxY) &&
+                inPoly(poly, k->point, countBorder))
         {
             contains[k->id].insert(p_shape);
         }
@@ -1807,6 +2460,7 @@ ConnType Router::validConnType(const ConnType select) const
 void Router::setRoutingParameter(const RoutingParameter parameter,
         const double value)
 {
+    waitForAsyncTransactions();
     COLA_ASSERT(parameter < lastRoutingParameterMarker);
     if (value < 0)
     {
@@ -1837,6 +2491,7 @@ void Router::setRoutingParameter(const RoutingParameter parameter,
     {
         m_routing_parameters[parameter] = value;
     }
+    ++m_route_cache_epoch;
 }
 
 
@@ -1849,8 +2504,10 @@ double Router::routingParameter(const RoutingParameter parameter) const
 
 void Router::setRoutingOption(const RoutingOption option, const bool value)
 {
+    waitForAsyncTransactions();
     COLA_ASSERT(option < lastRoutingOptionMarker);
     m_routing_options[option] = value;
+    ++m_route_cache_epoch;
 }
 
 
@@ -1870,6 +2527,7 @@ void Router::setRoutingPenalty(const RoutingParameter penType,
 
 HyperedgeRerouter *Router::hyperedgeRerouter(void)
 {
+    waitForAsyncTransactions();
     return &m_hyperedge_rerouter;
 }
 
@@ -2103,8 +2761,15 @@ bool Router::existsInvalidOrthogonalPaths(void)
 }
 
 
+const TransactionStatistics& Router::transactionStatistics(void) const
+{
+    return timers.transactionStatistics();
+}
+
+
 void Router::setSlowRoutingCallback(bool (*func)(unsigned int, double))
 {
+    waitForAsyncTransactions();
     m_slow_routing_callback = func;
 }
 
@@ -33,12 +33,14 @@
 #include <list>
 #include <utility>
 #include <string>
+#include <map>
 
 #include "libavoid/connector.h"
 #include "libavoid/vertices.h"
 #include "libavoid/graph.h"
 #include "libavoid/timer.h"
 #include "libavoid/hyperedge.h"
+#include "libavoid/makepath.h"
 
 #if defined(LINEDEBUG) || defined(ASTAR_DEBUG) || defined(LIBAVOID_SDL)
     #include <SDL.h>
@@ -60,6 +62,11 @@ class ClusterRef;
 typedef std::list<ClusterRef *> ClusterRefList;
 class Obstacle;
 typedef std::list<Obstacle *> ObstacleList;
+class BlockPool;
+template <typename T> class BBoxIndex;
+typedef BBoxIndex<Obstacle> ObstacleBBoxIndex;
+typedef BBoxIndex<ClusterRef> ClusterBBoxIndex;
+class AsyncTransactionWorker;
 
 //! @brief  Flags that can be passed to the router during initialisation 
 //!         to specify options.
@@ -175,6 +182,48 @@ enum RoutingOption
     //! @note   This will allow routes to be nudged up to the bounds of shapes, 
     //!         additional space for this nudging can be specified via the 
     nudgeOrthogonalTouchingColinearSegments,
+    //! @brief  This option causes orthogonal connector routing to use 
+    //!         precomputed shortest path distances from a handful of 
+    //!         landmark vertices in the orthogonal visibility graph as a 
+    //!         lower bound on route length.  This bound takes obstacles 
+    //!         into account, so the A* search explores far fewer nodes when
+    //!         routing around large obstacles.  The landmark distances are
+    //!         recomputed whenever the orthogonal visibility graph is
+    //!         regenerated.  This option is not set by default.
+    //! @note   Routes will still have the same cost, but where there are
+    //!         several equal cost routes a different one may be chosen.
+    useLandmarkHeuristicForOrthogonalRouting,
+    //! @brief  This option causes the router to remember the region of the
+    //!         orthogonal visibility graph that was searched to find each
+    //!         orthogonal connector's route.  In later transactions a 
+    //!         connector will not be rerouted if none of the shapes, 
+    //!         junctions or connector endpoints changed in that transaction
+    //!         intersect its search region.  Changing any routing parameter
+    //!         or option, or adding or removing clusters, causes all 
+    //!         connectors to be rerouted.  This option has no effect while 
+    //!         crossingPenalty or fixedSharedPathPenalty is set.  It is not
+    //!         set by default.
+    //! @note   A connector that is not rerouted will still be nudged and
+    //!         will still receive a callback if its final route changes.
+    cacheOrthogonalRoutesOfUnaffectedConnectors,
+    //! @brief  This option causes the A* search for orthogonal connector 
+    //!         routes to keep its pending search nodes in a radix heap, 
+    //!         bucketed by path cost quantised to 1/1024 of a unit, rather 
+    //!         than in a single binary heap.  This is faster for searches 
+    //!         with many pending nodes.  Nodes are still examined in the 
+    //!         same order, so routes are unchanged.  This option is not set
+    //!         by default.
+    useRadixHeapForOrthogonalRouting,
+    //! @brief  This option causes the minimum terminal spanning trees for 
+    //!         all the hyperedges being rerouted in a transaction to be 
+    //!         computed concurrently, using OpenMP threads.  The new 
+    //!         junctions and connectors are still created, and the old ones
+    //!         deleted, one hyperedge at a time in the order the hyperedges
+    //!         were registered, so the results are the same as when this 
+    //!         option is not set.  This option is not set by default.
+    //! @note   The trees are only computed in parallel if libavoid was 
+    //!         compiled with OpenMP support.
+    computeHyperedgeTreesConcurrently,
     
     // Used for determining the size of the routing options array.
     // This should always we the last value in the enum.
@@ -307,6 +356,109 @@ class Router {
         //!
         bool processTransaction(void);
 
+        //! @brief Finishes the current transaction and processes the queued
+        //!        object changes, aiming to return within a time budget.
+        //!
+        //! This is intended for interactive use, such as while the user is
+        //! dragging a shape, where a quick approximate result is preferable
+        //! to a slow final one.  When there are queued changes, connectors
+        //! are rerouted cheaply: connectors whose previous route searches 
+        //! were unaffected by the changes keep their routes, and crossing 
+        //! improvement, hyperedge improvement and nudging are skipped.
+        //! Unless the cacheOrthogonalRoutesOfUnaffectedConnectors option is
+        //! set and there are no crossing or shared path penalties, the kept
+        //! routes may not be final, so those connectors are rerouted as
+        //! part of the refinement.  If the budget runs out while rerouting,
+        //! the remaining connectors keep their previous routes for now.  
+        //! Connectors whose endpoints have moved are rerouted regardless of
+        //! the budget.
+        //!
+        //! The skipped work is carried out by the next call to either 
+        //! version of processTransaction(), even if no further changes 
+        //! have been queued.  A budgeted call with no queued changes 
+        //! reroutes any connectors left over and then, if all of them 
+        //! were routed in time, performs the deferred refinement.  If the
+        //! budget runs out during crossing improvement then the remaining
+        //! connectors are rerouted without crossing penalties, as if the 
+        //! slow routing callback had asked for this.  Nudging cannot be 
+        //! interrupted, so a refining call may exceed its budget.
+        //!
+        //! @param[in]  timeBudget  The time budget for the transaction, in
+        //!                         msec.
+        //! @return A boolean value describing whether there were any actions
+        //!         to process or deferred work to perform.
+        //!
+        //! @sa refinementPending
+        //!
+        bool processTransaction(const unsigned int timeBudget);
+
+        //! @brief  Returns whether a time-budgeted transaction has left 
+        //!         routing or route refinement to be done by the next call
+        //!         to processTransaction().
+        //!
+        //! @return A boolean value describing whether refinement is pending.
+        //!
+        bool refinementPending(void) const;
+
+        //! @brief Starts processing the queued changes on a background 
+        //!        thread, and returns immediately.
+        //!
+        //! The background thread works on the router's shapes, junctions
+        //! and connectors themselves.  While a background transaction is
+        //! in progress, moveShape() and moveJunction() with new absolute
+        //! positions queue the moves without waiting for it, as described
+        //! below.  Every other method that adds, removes or changes an
+        //! object or a routing setting, including the relative versions of
+        //! moveShape() and moveJunction(), first waits for the background
+        //! transaction to finish.  Routes should be read with
+        //! completedRoute() rather than ConnRef::displayRoute().
+        //!
+        //! Moves queued during a background transaction supersede it.  The
+        //! in-flight transaction stops rerouting connectors, leaving the 
+        //! rest with their previous routes, and another transaction with 
+        //! the new moves is run as soon as it finishes.  Calling this 
+        //! method while a background transaction is in progress does 
+        //! nothing more, since the background thread will pick up the 
+        //! newly queued moves itself.
+        //!
+        //! Either version of processTransaction() also waits for any
+        //! background transaction to finish.  So if transactions are not
+        //! in use, moveShape() and moveJunction() will block until then.
+        //!
+        //! Connector callbacks are called on the background thread, and 
+        //! must not call processTransaction().
+        //!
+        //! @sa completedRoute
+        //! @sa waitForAsyncTransactions
+        //!
+        void processTransactionAsync(void);
+
+        //! @brief  Returns whether a background transaction is in progress.
+        //!
+        //! @return A boolean value describing whether the background 
+        //!         thread is still routing.
+        //!
+        bool asyncTransactionInProgress(void) const;
+
+        //! @brief  Blocks until any background transactions have finished.
+        //!
+        //! Afterwards all router methods may be used again.
+        //!
+        void waitForAsyncTransactions(void);
+
+        //! @brief  Returns the display route of a connector as of the most
+        //!         recently completed background transaction.
+        //!
+        //! This may be called while a background transaction is in 
+        //! progress.
+        //!
+        //! @param[in]   conn   The connector whose route is wanted.
+        //! @param[out]  route  Set to the connector's display route.
+        //! @return A boolean value describing whether a background 
+        //!         transaction has completed a route for the connector.
+        //!
+        bool completedRoute(const ConnRef *conn, Polygon& route) const;
+
         //! @brief Delete a shape from the router scene.
         //!
         //! Connectors that could have a better (usually shorter) path after
@@ -567,6 +719,17 @@ class Router {
         //!
         void setSlowRoutingCallback(bool (*func)(unsigned int, double));
 
+        //! @brief  Returns the time taken and work done in each phase of
+        //!         the most recently processed transaction.
+        //!
+        //! Phases are timed with a monotonic clock, in nanoseconds.  The 
+        //! statistics are reset at the start of each call to 
+        //! processTransaction() that has changes to process.
+        //!
+        //! @return  A reference to the statistics for the last transaction.
+        //!
+        const TransactionStatistics& transactionStatistics(void) const;
+
         void deleteCluster(ClusterRef *cluster);
         void attachedShapes(IntList &shapes, const unsigned int shapeId,
                 const unsigned int type);
@@ -597,6 +760,11 @@ class Router {
         friend class MinimumTerminalSpanningTree;
         friend class ConnEnd;
         friend struct HyperEdgeTreeNode;
+        friend class EdgeInf;
+        friend class VertInf;
+        friend class AsyncTransactionWorker;
+        friend void aStarPath(ConnRef *lineRef, VertInf *src, VertInf *tar,
+                VertInf *start);
 
         unsigned int assignId(const unsigned int suggestedId);
         void addShape(ShapeRef *shape);
@@ -616,7 +784,17 @@ class Router {
         void adjustClustersWithAdd(const PolygonInterface& poly, 
                 const int p_cluster);
         void adjustClustersWithDel(const int p_cluster);
+        bool processQueuedActions(void);
+        bool transactionBudgetExhausted(void) const;
+        bool transactionSuperseded(void) const;
+        void runAsyncTransactions(void);
+        void publishCompletedRoutes(void);
         void rerouteAndCallbackConnectors(void);
+        void addChangedRegion(const BBox& changed);
+        void addChangedRegion(const Polygon& poly);
+        void addChangedRegion(const Point& point);
+        bool connectorSearchRegionUnchanged(const ConnRef *conn) const;
+        bool cachedOrthogonalRoutesAreFinal(void) const;
         void improveCrossings(void);
         void performSlowRoutingCallBack(double completeFraction);
 
@@ -628,14 +806,52 @@ class Router {
         double m_routing_parameters[lastRoutingParameterMarker];
         bool m_routing_options[lastRoutingOptionMarker];
         
+        // Bounding box indexes for containment queries.
+        ObstacleBBoxIndex *m_obstacle_bbox_index;
+        ClusterBBoxIndex *m_cluster_bbox_index;
+
         ConnRerouteFlagDelegate m_conn_reroute_flags;
         HyperedgeRerouter m_hyperedge_rerouter;
+        AStarLandmarks m_astar_landmarks;
+        AStarNodePool m_astar_node_pool;
+        // Storage for all of this router's visibility graph edges, and for
+        // the extra state of its poly-line edges.
+        BlockPool *m_edge_pool;
+        BlockPool *m_poly_line_state_pool;
+        // Arenas for the orthogonal visibility graph's edges and dummy 
+        // vertices, reclaimed as a whole by destroyOrthogonalVisGraph().
+        BlockPool *m_orthogonal_edge_arena;
+        BlockPool *m_orthogonal_vertex_arena;
+
+        // Regions containing shapes, junctions and connector endpoints
+        // changed by the current transaction, and an epoch number that is
+        // incremented by global changes that affect every route.  Used to
+        // decide whether connectors can keep their existing routes.
+        std::vector<BBox> m_changed_regions;
+        unsigned int m_route_cache_epoch;
         
         // Slow-routing callback member variables. 
         bool (*m_slow_routing_callback)(unsigned int, double);
         clock_t m_transaction_start_time;
         bool m_abort_transaction;
 
+        // Time budget for the current transaction, and whether refinement
+        // of the routes is skipped or has been left for a later call.
+        bool m_transaction_budgeted;
+        bigclock_t m_transaction_deadline;
+        bool m_defer_refinement;
+        bool m_refinement_pending;
+
+        // Background transaction state.  While the background thread is 
+        // running, moves are queued in m_async_queued_actions rather than 
+        // actionList, and all other changes wait for it to finish.  These,
+        // m_async_transaction_running and m_completed_routes are protected
+        // by the worker's lock.
+        AsyncTransactionWorker *m_async_worker;
+        ActionInfoList m_async_queued_actions;
+        bool m_async_transaction_running;
+        std::map<unsigned int, Polygon> m_completed_routes;
+
         // Overall modes:
         bool m_allows_polyline_routing;
         bool m_allows_orthogonal_routing;
@@ -78,6 +78,7 @@ void ShapeRef::moveAttachedConns(const Polygon& newPoly)
 void ShapeRef::transformConnectionPinPositions(
         ShapeTransformationType transform)
 {
+    m_router->waitForAsyncTransactions();
     for (ShapeConnectionPinSet::iterator curr = 
             m_connection_pins.begin(); curr != m_connection_pins.end(); ++curr)
     {
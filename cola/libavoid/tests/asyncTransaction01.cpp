@@ -0,0 +1,154 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// A shape is dragged down through a bundle of connectors, with each step
+// processed on a background thread while the next moves are queued.  The
+// routes completed in the background must match those of a router that
+// processes each transaction synchronously.  Then, while a background
+// transaction is in progress, shapes, connectors and routing settings are
+// changed, and each change must wait for the background thread rather
+// than change the router alongside it.
+
+#include <cstdio>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+int main(void)
+{
+    // Router 0 processes transactions synchronously, router 1 in the
+    // background.
+    Router *routers[2];
+    std::vector<ConnRef *> conns[2];
+    ShapeRef *draggedShape[2];
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 50);
+        routers[variant] = router;
+
+        // Columns of shapes either side of the bundle.
+        for (int i = 0; i < 6; ++i)
+        {
+            Rectangle leftRect(Point(100, 100 + (i * 120)),
+                    Point(180, 180 + (i * 120)));
+            new ShapeRef(router, leftRect);
+            Rectangle rightRect(Point(620, 100 + (i * 120)),
+                    Point(700, 180 + (i * 120)));
+            new ShapeRef(router, rightRect);
+        }
+        Rectangle draggedRect(Point(350, 0), Point(450, 60));
+        draggedShape[variant] = new ShapeRef(router, draggedRect);
+        for (int i = 0; i < 6; ++i)
+        {
+            conns[variant].push_back(new ConnRef(router,
+                    ConnEnd(Point(180, 140 + (i * 120)), ConnDirRight),
+                    ConnEnd(Point(620, 140 + (i * 120)), ConnDirLeft)));
+        }
+    }
+    routers[0]->processTransaction();
+    routers[1]->processTransactionAsync();
+
+    // Drag the shape down while earlier transactions may still be running.
+    Router *asyncRouter = routers[1];
+    for (int i = 1; i <= 20; ++i)
+    {
+        Rectangle rect(Point(350, i * 30), Point(450, 60 + (i * 30)));
+        asyncRouter->moveShape(draggedShape[1], rect);
+        asyncRouter->processTransactionAsync();
+
+        Polygon route;
+        asyncRouter->completedRoute(conns[1][0], route);
+    }
+    asyncRouter->waitForAsyncTransactions();
+    routers[0]->moveShape(draggedShape[0], 0, 600);
+    routers[0]->processTransaction();
+
+    bool valid = true;
+    if (asyncRouter->asyncTransactionInProgress())
+    {
+        printf("Background transaction still in progress.\n");
+        valid = false;
+    }
+    for (size_t i = 0; i < conns[1].size(); ++i)
+    {
+        Polygon route;
+        if (!asyncRouter->completedRoute(conns[1][i], route))
+        {
+            printf("Connector %d has no completed route.\n", (int) i);
+            valid = false;
+        }
+        else if ((route.ps != conns[0][i]->displayRoute().ps) ||
+                (route.ps != conns[1][i]->displayRoute().ps))
+        {
+            printf("Connector %d has a different route.\n", (int) i);
+            valid = false;
+        }
+    }
+
+    // Each change below is made just after starting a background
+    // transaction, and must return only once it has finished.
+    for (int change = 0; change < 6; ++change)
+    {
+        asyncRouter->moveShape(draggedShape[1],
+                Rectangle(Point(350, 300), Point(450, 360 + change)));
+        asyncRouter->processTransactionAsync();
+        switch (change)
+        {
+            case 0:
+            {
+                Rectangle rect(Point(350, 900), Point(450, 960));
+                new ShapeRef(asyncRouter, rect);
+                break;
+            }
+            case 1:
+                asyncRouter->moveShape(draggedShape[1], 10, 0);
+                break;
+            case 2:
+                conns[1][0]->setSourceEndpoint(
+                        ConnEnd(Point(180, 150), ConnDirRight));
+                break;
+            case 3:
+                asyncRouter->setRoutingParameter(crossingPenalty, 100);
+                break;
+            case 4:
+                asyncRouter->hyperedgeRerouter();
+                break;
+            case 5:
+                asyncRouter->setTransactionUse(false);
+                break;
+        }
+        if (asyncRouter->asyncTransactionInProgress())
+        {
+            printf("Change %d did not wait for the background thread.\n",
+                    change);
+            valid = false;
+        }
+        asyncRouter->processTransaction();
+    }
+    if (asyncRouter->existsInvalidOrthogonalPaths())
+    {
+        valid = false;
+    }
+
+    delete routers[0];
+    delete routers[1];
+    return valid ? 0 : 1;
+}
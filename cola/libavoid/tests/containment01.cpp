@@ -0,0 +1,148 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// Checks the shapes and clusters the router records as containing each
+// connector endpoint against a test of every polygon, as shapes and
+// clusters are added, moved and removed.  The scene has a wide shape, so
+// that shapes far to the left of a point can still contain it, a triangle
+// whose bounding box holds points the triangle does not, and endpoints on
+// shape borders.
+
+#include <cstdio>
+#include <list>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static bool checkContainment(Router *router,
+        const std::list<ShapeRef *>& shapes,
+        const std::list<ClusterRef *>& clusters)
+{
+    bool valid = true;
+    for (VertInf *vert = router->vertices.connsBegin();
+            vert != router->vertices.shapesBegin(); vert = vert->lstNext)
+    {
+        ShapeSet expected;
+        for (std::list<ShapeRef *>::const_iterator shape = shapes.begin();
+                shape != shapes.end(); ++shape)
+        {
+            if (inPoly((*shape)->polygon(), vert->point, false))
+            {
+                expected.insert((*shape)->id());
+            }
+        }
+        ShapeSet expectedClusters;
+        for (std::list<ClusterRef *>::const_iterator cluster =
+                clusters.begin(); cluster != clusters.end(); ++cluster)
+        {
+            if (inPolyGen((*cluster)->polygon(), vert->point))
+            {
+                expectedClusters.insert((*cluster)->id());
+            }
+        }
+        ShapeSet& contains = router->contains[vert->id];
+        ShapeSet& enclosing = router->enclosingClusters[vert->id];
+        if (!std::equal(contains.begin(), contains.end(), expected.begin()) ||
+                (contains.size() != expected.size()))
+        {
+            printf("Endpoint (%g, %g) is in %d shapes, expected %d.\n",
+                    vert->point.x, vert->point.y, (int) contains.size(),
+                    (int) expected.size());
+            valid = false;
+        }
+        if (!std::equal(enclosing.begin(), enclosing.end(),
+                    expectedClusters.begin()) ||
+                (enclosing.size() != expectedClusters.size()))
+        {
+            printf("Endpoint (%g, %g) is in %d clusters, expected %d.\n",
+                    vert->point.x, vert->point.y, (int) enclosing.size(),
+                    (int) expectedClusters.size());
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    std::list<ShapeRef *> shapes;
+    std::list<ClusterRef *> clusters;
+
+    // A wide shape along the bottom, with a small one inside its right end.
+    Rectangle wide(Point(0, 0), Point(1000, 100));
+    shapes.push_back(new ShapeRef(router, wide));
+    Rectangle inner(Point(900, 20), Point(960, 80));
+    ShapeRef *innerShape = new ShapeRef(router, inner);
+    shapes.push_back(innerShape);
+
+    // Two overlapping shapes above it.
+    Rectangle left(Point(100, 200), Point(300, 400));
+    shapes.push_back(new ShapeRef(router, left));
+    Rectangle right(Point(250, 250), Point(450, 450));
+    ShapeRef *rightShape = new ShapeRef(router, right);
+    shapes.push_back(rightShape);
+
+    // A triangle, whose bounding box holds (780, 220) but it does not.
+    Polygon triangle(3);
+    triangle.ps[0] = Point(700, 200);
+    triangle.ps[1] = Point(800, 400);
+    triangle.ps[2] = Point(600, 400);
+    shapes.push_back(new ShapeRef(router, triangle));
+
+    Point endpoints[] = {
+        Point(50, 50), Point(950, 50), Point(850, 50), Point(280, 300),
+        Point(200, 300), Point(400, 420), Point(700, 350), Point(780, 220),
+        Point(100, 300), Point(1000, 50), Point(500, 600), Point(520, 150)
+    };
+    const size_t count = sizeof(endpoints) / sizeof(Point);
+    for (size_t i = 0; i + 1 < count; i += 2)
+    {
+        ConnRef *conn = new ConnRef(router, endpoints[i], endpoints[i + 1]);
+        conn->setRoutingType(ConnType_Orthogonal);
+    }
+    router->processTransaction();
+    bool valid = checkContainment(router, shapes, clusters);
+
+    // Move shapes onto and off endpoints.
+    router->moveShape(rightShape, 200, 0);
+    router->moveShape(innerShape, -850, 0);
+    router->processTransaction();
+    valid &= checkContainment(router, shapes, clusters);
+
+    // Add a shape and a cluster, and remove a shape.
+    Rectangle added(Point(450, 500), Point(550, 700));
+    shapes.push_back(new ShapeRef(router, added));
+    Rectangle clusterRect(Point(0, 150), Point(500, 500));
+    ClusterRef *cluster = new ClusterRef(router, clusterRect);
+    clusters.push_back(cluster);
+    router->deleteShape(innerShape);
+    shapes.remove(innerShape);
+    router->processTransaction();
+    valid &= checkContainment(router, shapes, clusters);
+
+    // Remove the cluster again.
+    router->deleteCluster(cluster);
+    clusters.remove(cluster);
+    router->processTransaction();
+    valid &= checkContainment(router, shapes, clusters);
+
+    delete router;
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,129 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// Four hyperedges share the same area of a grid of shapes, so their trees
+// run through each other's old connectors.  Computed concurrently, all the
+// trees are built from the same visibility graph before any hyperedge is
+// replaced, so the junctions and connector routes must be the same on every
+// run.  Serial rerouting builds each tree after the hyperedges before it
+// have been replaced, so its result can differ; it is only checked for
+// validity.
+
+#include <cstdio>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+int main(void)
+{
+    // Serial, then concurrent twice.
+    std::vector<Point> positions[3];
+    std::vector<Polygon> routes[3];
+    bool valid = true;
+
+    for (int variant = 0; variant < 3; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 50);
+        router->setRoutingOption(computeHyperedgeTreesConcurrently,
+                (variant > 0));
+
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int col = 0; col < 4; ++col)
+            {
+                Rectangle rect(Point(100 + (col * 200), 100 + (row * 200)),
+                        Point(160 + (col * 200), 160 + (row * 200)));
+                new ShapeRef(router, rect);
+            }
+        }
+
+        // Each hyperedge joins four endpoints, one near each side of the
+        // grid, to a single junction.
+        std::vector<JunctionRef *> junctions;
+        for (int i = 0; i < 4; ++i)
+        {
+            double offset = i * 15;
+            Point terminals[4] = { Point(40 + offset, 40),
+                    Point(860, 60 + offset), Point(460 + offset, 860),
+                    Point(40, 440 + offset) };
+            JunctionRef *junction = new JunctionRef(router,
+                    Point(250 + offset, 250));
+            junctions.push_back(junction);
+            for (int j = 0; j < 4; ++j)
+            {
+                new ConnRef(router, ConnEnd(terminals[j], ConnDirAll),
+                        ConnEnd(junction));
+            }
+        }
+        router->processTransaction();
+
+        HyperedgeRerouter *rerouter = router->hyperedgeRerouter();
+        for (size_t i = 0; i < junctions.size(); ++i)
+        {
+            rerouter->registerHyperedgeForRerouting(junctions[i]);
+        }
+        router->processTransaction();
+        if (router->existsInvalidOrthogonalPaths())
+        {
+            valid = false;
+        }
+
+        // Record all obstacles and connectors, including the new junctions
+        // and connectors of the rerouted hyperedges.
+        for (ObstacleList::iterator obstacle = router->m_obstacles.begin();
+                obstacle != router->m_obstacles.end(); ++obstacle)
+        {
+            positions[variant].push_back((*obstacle)->position());
+        }
+        for (ConnRefList::iterator conn = router->connRefs.begin();
+                conn != router->connRefs.end(); ++conn)
+        {
+            routes[variant].push_back((*conn)->displayRoute());
+        }
+        delete router;
+    }
+    printf("%d obstacles, %d connectors.\n", (int) positions[1].size(),
+            (int) routes[1].size());
+
+    if ((positions[2].size() != positions[1].size()) ||
+            (routes[2].size() != routes[1].size()))
+    {
+        printf("Different numbers of obstacles or connectors.\n");
+        return 1;
+    }
+    for (size_t i = 0; i < positions[1].size(); ++i)
+    {
+        if (positions[2][i] != positions[1][i])
+        {
+            printf("Obstacle %d differs.\n", (int) i);
+            valid = false;
+        }
+    }
+    for (size_t i = 0; i < routes[1].size(); ++i)
+    {
+        if (routes[2][i].ps != routes[1][i].ps)
+        {
+            printf("Connector %d differs.\n", (int) i);
+            valid = false;
+        }
+    }
+    return valid ? 0 : 1;
+}
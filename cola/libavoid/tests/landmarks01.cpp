@@ -0,0 +1,125 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// Connectors must cross a tall wall whose only way around is far above
+// or below the endpoints, so the Manhattan distance badly underestimates
+// the remaining cost and A* searches the whole area in front of the wall.
+// The scene is routed with and without the landmark heuristic, which must
+// give routes of the same cost while expanding fewer search nodes.  One
+// connector ends at a connection pin, whose vertex is bounded through the
+// pin's dummy edge.
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+#include "libavoid/geometry.h"
+using namespace Avoid;
+
+int main(void)
+{
+    const double segPenalty = 50;
+    std::vector<double> costs[2];
+    unsigned int expansions[2];
+    bool valid = true;
+
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        bool useLandmarks = (variant == 1);
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, segPenalty);
+        router->setRoutingOption(useLandmarkHeuristicForOrthogonalRouting,
+                useLandmarks);
+
+        // The wall, with columns of small shapes on either side of it to
+        // fill the area the search has to explore.
+        Rectangle wall(Point(480, 0), Point(520, 2000));
+        new ShapeRef(router, wall);
+        for (int i = 0; i < 20; ++i)
+        {
+            double y = 100 + (i * 90);
+            double xs[] = { 100, 300, 660, 860 };
+            for (int j = 0; j < 4; ++j)
+            {
+                Rectangle rect(Point(xs[j], y), Point(xs[j] + 40, y + 40));
+                new ShapeRef(router, rect);
+            }
+        }
+
+        std::vector<ConnRef *> conns;
+        for (int i = 0; i < 10; ++i)
+        {
+            ConnEnd srcPt(Point(200, 1000 + (i * 10)), ConnDirAll);
+            ConnEnd dstPt(Point(800, 1000 - (i * 10)), ConnDirAll);
+            conns.push_back(new ConnRef(router, srcPt, dstPt));
+        }
+
+        Rectangle pinRect(Point(950, 950), Point(990, 990));
+        ShapeRef *pinShape = new ShapeRef(router, pinRect);
+        new ShapeConnectionPin(pinShape, 1, ATTACH_POS_LEFT,
+                ATTACH_POS_CENTRE, 0, ConnDirLeft);
+        new ShapeConnectionPin(pinShape, 1, ATTACH_POS_CENTRE,
+                ATTACH_POS_TOP, 0, ConnDirUp);
+        conns.push_back(new ConnRef(router,
+                ConnEnd(Point(50, 1500), ConnDirAll), ConnEnd(pinShape, 1)));
+
+        router->processTransaction();
+        expansions[variant] =
+                router->transactionStatistics().total(ctAStarExpansions);
+        if (router->existsInvalidOrthogonalPaths())
+        {
+            valid = false;
+        }
+
+        for (size_t i = 0; i < conns.size(); ++i)
+        {
+            const PolyLine& route = conns[i]->route();
+            double cost = 0;
+            for (size_t j = 1; j < route.size(); ++j)
+            {
+                cost += manhattanDist(route.ps[j - 1], route.ps[j]);
+                if ((j + 1 < route.size()) && !colinear(route.ps[j - 1],
+                            route.ps[j], route.ps[j + 1]))
+                {
+                    cost += segPenalty;
+                }
+            }
+            costs[variant].push_back(cost);
+        }
+        delete router;
+    }
+
+    for (size_t i = 0; i < costs[0].size(); ++i)
+    {
+        if (fabs(costs[0][i] - costs[1][i]) > 0.0001)
+        {
+            printf("Connector %d: cost %g without landmarks, %g with.\n",
+                    (int) i, costs[0][i], costs[1][i]);
+            valid = false;
+        }
+    }
+    printf("A* nodes expanded: %u without landmarks, %u with.\n",
+            expansions[0], expansions[1]);
+    if (expansions[1] >= expansions[0])
+    {
+        valid = false;
+    }
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// The radix heap keys A* nodes on their cost quantised to 1/1024, and
+// orders nodes sharing a key by the usual node order.  Shapes here sit at
+// non-integral positions, some only a fraction of a key apart, with pins on
+// both sides so that many paths reach the same vertex at nearly the same
+// cost.  The scene is routed with the binary heap and with the radix heap,
+// which must give exactly the same routes.
+
+#include <cstdio>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+int main(void)
+{
+    std::vector<Polygon> routes[2];
+    bool valid = true;
+
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 37.5);
+        router->setRoutingOption(useRadixHeapForOrthogonalRouting,
+                (variant == 1));
+
+        std::vector<ShapeRef *> shapes;
+        for (int i = 0; i < 6; ++i)
+        {
+            for (int j = 0; j < 6; ++j)
+            {
+                // Odd columns are offset by less than a radix heap key.
+                double x = 100 + (i * 150.3) + ((j % 2) * 0.0004);
+                double y = 100 + (j * 120.7) + ((i % 2) * 30.1);
+                Rectangle rect(Point(x, y), Point(x + 60, y + 45.5));
+                ShapeRef *shape = new ShapeRef(router, rect);
+                new ShapeConnectionPin(shape, 1, ATTACH_POS_LEFT,
+                        ATTACH_POS_CENTRE, 0, ConnDirLeft);
+                new ShapeConnectionPin(shape, 1, ATTACH_POS_RIGHT,
+                        ATTACH_POS_CENTRE, 0, ConnDirRight);
+                shapes.push_back(shape);
+            }
+        }
+
+        std::vector<ConnRef *> conns;
+        for (size_t i = 0; i < shapes.size(); i += 5)
+        {
+            size_t j = shapes.size() - 1 - ((i * 7) % shapes.size());
+            conns.push_back(new ConnRef(router, ConnEnd(shapes[i], 1),
+                    ConnEnd(shapes[j], 1)));
+        }
+        conns.push_back(new ConnRef(router, ConnEnd(Point(50.2, 50.9)),
+                ConnEnd(Point(1000.4, 900.1))));
+        router->processTransaction();
+
+        for (size_t i = 0; i < conns.size(); ++i)
+        {
+            routes[variant].push_back(conns[i]->displayRoute());
+        }
+        const TransactionStatistics& stats = router->transactionStatistics();
+        printf("A* nodes expanded: %u, bytes allocated: %u\n",
+                stats.total(ctAStarExpansions),
+                stats.total(ctAStarBytesAllocated));
+        if ((stats.total(ctAStarExpansions) == 0) ||
+                (stats.total(ctAStarBytesAllocated) == 0) ||
+                router->existsInvalidOrthogonalPaths())
+        {
+            valid = false;
+        }
+        delete router;
+    }
+
+    for (size_t i = 0; i < routes[0].size(); ++i)
+    {
+        if (routes[0][i].ps != routes[1][i].ps)
+        {
+            printf("Connector %d has a different route.\n", (int) i);
+            valid = false;
+        }
+    }
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// Two groups of connectors sit far apart, each routed around a pair of
+// shapes, and a shape in the second group is moved.  With the route cache
+// enabled, the connectors of the first group must not be rerouted or
+// redrawn, while the final routes match those of a router that reroutes
+// everything.  Then shapes of a grid are moved and removed at random, some
+// of them away from the connectors but on the scanlines their routes bend
+// on, and the routes must still match.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+static void connCallback(void *ptr)
+{
+    int *callbacks = (int *) ptr;
+    (*callbacks)++;
+}
+
+int main(void)
+{
+    // Routers 0 reroute everything, routers 1 use the route cache.
+    Router *routers[2];
+    std::vector<ConnRef *> conns[2];
+    ShapeRef *movingShape[2];
+    int callbacks[2][6];
+    bool valid = true;
+
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 50);
+        router->setRoutingOption(cacheOrthogonalRoutesOfUnaffectedConnectors,
+                (variant == 1));
+        routers[variant] = router;
+
+        // The groups do not share any scanlines.
+        for (int group = 0; group < 2; ++group)
+        {
+            double offset = group * 2000;
+            Rectangle upperRect(Point(offset + 100, offset + 100),
+                    Point(offset + 200, offset + 200));
+            new ShapeRef(router, upperRect);
+            Rectangle lowerRect(Point(offset + 300, offset + 300),
+                    Point(offset + 400, offset + 400));
+            movingShape[variant] = new ShapeRef(router, lowerRect);
+            for (int i = 0; i < 3; ++i)
+            {
+                ConnEnd srcPt(Point(offset + 50, offset + 150 + (i * 20)),
+                        ConnDirAll);
+                ConnEnd dstPt(Point(offset + 500, offset + 350 + (i * 20)),
+                        ConnDirAll);
+                ConnRef *conn = new ConnRef(router, srcPt, dstPt);
+                conn->setCallback(connCallback, &(callbacks[variant][
+                            conns[variant].size()]));
+                conns[variant].push_back(conn);
+            }
+        }
+        router->processTransaction();
+
+        for (int i = 0; i < 6; ++i)
+        {
+            callbacks[variant][i] = 0;
+        }
+        router->moveShape(movingShape[variant], 0, 40);
+        router->processTransaction();
+    }
+
+    for (size_t i = 0; i < conns[0].size(); ++i)
+    {
+        if (conns[0][i]->displayRoute().ps != conns[1][i]->displayRoute().ps)
+        {
+            printf("Connector %d has a different route.\n", (int) i);
+            valid = false;
+        }
+        // Only the connectors near the moved shape should have changed.
+        bool nearMovedShape = (i >= 3);
+        if ((callbacks[1][i] > 0) != nearMovedShape)
+        {
+            printf("Connector %d: %d callbacks.\n", (int) i,
+                    callbacks[1][i]);
+            valid = false;
+        }
+    }
+    unsigned int hits =
+            routers[1]->transactionStatistics().total(ctRouteCacheHits);
+    printf("Route cache hits: %u\n", hits);
+    if ((hits != 3) ||
+            (routers[0]->transactionStatistics().total(ctRouteCacheHits) != 0)
+            || routers[1]->existsInvalidOrthogonalPaths())
+    {
+        valid = false;
+    }
+    delete routers[0];
+    delete routers[1];
+
+    // A grid of shapes, with connectors spanning a cell or two so that some
+    // of them are clear of each change.
+    std::vector<ShapeRef *> shapes[2];
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 50);
+        router->setRoutingOption(cacheOrthogonalRoutesOfUnaffectedConnectors,
+                (variant == 1));
+        routers[variant] = router;
+        conns[variant].clear();
+
+        for (int row = 0; row < 5; ++row)
+        {
+            for (int col = 0; col < 5; ++col)
+            {
+                double x = col * 200, y = row * 200;
+                Rectangle rect(Point(x + 60, y + 60 + col * 7),
+                        Point(x + 140, y + 140 + row * 5));
+                shapes[variant].push_back(new ShapeRef(router, rect));
+            }
+        }
+        for (int i = 0; i < 20; ++i)
+        {
+            double x = (i % 5) * 200, y = (i / 5) * 200 + 20;
+            ConnEnd srcPt(Point(x + 20, y + 10 + i), ConnDirAll);
+            ConnEnd dstPt(Point(x + 180 + (i % 3) * 200,
+                        y + 170 + (i % 2) * 200), ConnDirAll);
+            conns[variant].push_back(new ConnRef(router, srcPt, dstPt));
+        }
+        router->processTransaction();
+    }
+
+    unsigned int gridHits = 0;
+    srand(1);
+    for (int step = 0; (step < 30) && !shapes[0].empty(); ++step)
+    {
+        size_t i = rand() % shapes[0].size();
+        bool remove = (rand() % 3 == 0);
+        double dx = (rand() % 61) - 30, dy = (rand() % 61) - 30;
+        for (int variant = 0; variant < 2; ++variant)
+        {
+            if (remove)
+            {
+                routers[variant]->deleteShape(shapes[variant][i]);
+                shapes[variant].erase(shapes[variant].begin() + i);
+            }
+            else
+            {
+                routers[variant]->moveShape(shapes[variant][i], dx, dy);
+            }
+            routers[variant]->processTransaction();
+        }
+        gridHits +=
+                routers[1]->transactionStatistics().total(ctRouteCacheHits);
+        for (size_t c = 0; c < conns[0].size(); ++c)
+        {
+            if (conns[0][c]->displayRoute().ps !=
+                    conns[1][c]->displayRoute().ps)
+            {
+                printf("Step %d: connector %d has a different route.\n",
+                        step, (int) c);
+                valid = false;
+            }
+        }
+    }
+    printf("Grid route cache hits: %u\n", gridHits);
+    if ((gridHits == 0) || routers[1]->existsInvalidOrthogonalPaths())
+    {
+        valid = false;
+    }
+    delete routers[0];
+    delete routers[1];
+
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// Connectors run down past a column of shapes, and the shapes are moved
+// with time-budgeted transactions.  The quick transactions must leave
+// refinement pending, a later call must complete it, connectors with moved
+// endpoints must be rerouted even without a budget, and the final routes
+// must match those of a router that processes every transaction in full.
+// Then, with a crossing penalty, connectors away from a moved shape keep
+// their routes during a budgeted transaction, but are rerouted by the
+// refinement, since their best routes depend on the other connectors.
+
+#include <cstdio>
+#include <vector>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+int main(void)
+{
+    // Routers 0 process every transaction in full, routers 1 are given
+    // time budgets.
+    Router *routers[2];
+    std::vector<ConnRef *> conns[2];
+    ShapeRef *movingShape[2];
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 50);
+        routers[variant] = router;
+        for (int i = 0; i < 5; ++i)
+        {
+            Rectangle rect(Point(100, 100 + (i * 150)),
+                    Point(200, 200 + (i * 150)));
+            movingShape[variant] = new ShapeRef(router, rect);
+        }
+        for (int i = 0; i < 4; ++i)
+        {
+            conns[variant].push_back(new ConnRef(router,
+                    ConnEnd(Point(130 + (i * 15), 50), ConnDirAll),
+                    ConnEnd(Point(170 - (i * 15), 900), ConnDirAll)));
+        }
+        router->processTransaction();
+    }
+
+    bool valid = true;
+    Router *budgetRouter = routers[1];
+    const TransactionStatistics& stats = budgetRouter->transactionStatistics();
+
+    // A generous budget: every connector is rerouted, but nudging is left
+    // for the next call.
+    routers[0]->moveShape(movingShape[0], 40, 0);
+    routers[0]->processTransaction();
+    budgetRouter->moveShape(movingShape[1], 40, 0);
+    if (!budgetRouter->processTransaction(10000) ||
+            !budgetRouter->refinementPending() ||
+            (stats.phases[tmOrthogNudge].runs != 0))
+    {
+        printf("Budgeted transaction did not defer refinement.\n");
+        valid = false;
+    }
+    if (!budgetRouter->processTransaction(10000) ||
+            budgetRouter->refinementPending() ||
+            (stats.phases[tmOrthogNudge].runs != 1))
+    {
+        printf("Budgeted transaction did not perform refinement.\n");
+        valid = false;
+    }
+    if (budgetRouter->processTransaction(10000))
+    {
+        printf("Budgeted transaction with nothing to do.\n");
+        valid = false;
+    }
+    for (size_t i = 0; i < conns[0].size(); ++i)
+    {
+        if (conns[0][i]->displayRoute().ps != conns[1][i]->displayRoute().ps)
+        {
+            printf("Connector %d has a different refined route.\n", (int) i);
+            valid = false;
+        }
+    }
+
+    // No budget at all: affected connectors keep their previous routes
+    // until a call with time to spare.
+    std::vector<Polygon> previousRoutes;
+    for (size_t i = 0; i < conns[1].size(); ++i)
+    {
+        previousRoutes.push_back(conns[1][i]->displayRoute());
+    }
+    routers[0]->moveShape(movingShape[0], -80, 0);
+    routers[0]->processTransaction();
+    budgetRouter->moveShape(movingShape[1], -80, 0);
+    budgetRouter->processTransaction(0);
+    budgetRouter->processTransaction(0);
+    if (!budgetRouter->refinementPending() ||
+            (stats.phases[tmOrthogRoute].counters[ctAStarExpansions] != 0))
+    {
+        printf("Connectors were rerouted without a budget.\n");
+        valid = false;
+    }
+    for (size_t i = 0; i < conns[1].size(); ++i)
+    {
+        if (conns[1][i]->displayRoute().ps != previousRoutes[i].ps)
+        {
+            printf("Connector %d was changed without a budget.\n", (int) i);
+            valid = false;
+        }
+    }
+    budgetRouter->processTransaction();
+    if (budgetRouter->refinementPending())
+    {
+        printf("Full transaction left refinement pending.\n");
+        valid = false;
+    }
+    for (size_t i = 0; i < conns[0].size(); ++i)
+    {
+        if (conns[0][i]->displayRoute().ps != conns[1][i]->displayRoute().ps)
+        {
+            printf("Connector %d has a different refined route.\n", (int) i);
+            valid = false;
+        }
+    }
+
+    // No budget, but a connector's endpoint has moved: that connector must
+    // still be rerouted, while the others keep their routes for now.
+    previousRoutes.clear();
+    for (size_t i = 0; i < conns[1].size(); ++i)
+    {
+        previousRoutes.push_back(conns[1][i]->displayRoute());
+    }
+    Point newSource(300, 50);
+    routers[0]->moveShape(movingShape[0], 80, 0);
+    conns[0][0]->setSourceEndpoint(ConnEnd(newSource, ConnDirAll));
+    routers[0]->processTransaction();
+    budgetRouter->moveShape(movingShape[1], 80, 0);
+    conns[1][0]->setSourceEndpoint(ConnEnd(newSource, ConnDirAll));
+    budgetRouter->processTransaction(0);
+    if (conns[1][0]->displayRoute().ps.empty() ||
+            (conns[1][0]->displayRoute().ps[0] != newSource))
+    {
+        printf("Connector with a moved endpoint was not rerouted.\n");
+        valid = false;
+    }
+    if (!budgetRouter->refinementPending())
+    {
+        printf("Budgeted transaction did not defer refinement.\n");
+        valid = false;
+    }
+    for (size_t i = 1; i < conns[1].size(); ++i)
+    {
+        if (conns[1][i]->displayRoute().ps != previousRoutes[i].ps)
+        {
+            printf("Connector %d was changed without a budget.\n", (int) i);
+            valid = false;
+        }
+    }
+    budgetRouter->processTransaction();
+    for (size_t i = 0; i < conns[0].size(); ++i)
+    {
+        if (conns[0][i]->displayRoute().ps != conns[1][i]->displayRoute().ps)
+        {
+            printf("Connector %d has a different refined route.\n", (int) i);
+            valid = false;
+        }
+    }
+    delete routers[0];
+    delete routers[1];
+
+    // With a crossing penalty.  A shape blocks the horizontal connectors
+    // off from the shape that is moved, so a budgeted transaction keeps
+    // their routes while the connector passing the moved shape is rerouted.
+    // With crossing penalties a route depends on the routes of the other
+    // connectors, so the refinement must reroute them all the same.
+    for (int variant = 0; variant < 2; ++variant)
+    {
+        Router *router = new Router(OrthogonalRouting);
+        router->setRoutingParameter(segmentPenalty, 50);
+        router->setRoutingParameter(crossingPenalty, 200);
+        router->setRoutingOption(cacheOrthogonalRoutesOfUnaffectedConnectors,
+                true);
+        routers[variant] = router;
+        conns[variant].clear();
+
+        Rectangle blockRect(Point(350, 550), Point(400, 700));
+        new ShapeRef(router, blockRect);
+        Rectangle rect(Point(450, 100), Point(550, 200));
+        movingShape[variant] = new ShapeRef(router, rect);
+        conns[variant].push_back(new ConnRef(router,
+                ConnEnd(Point(500, 50), ConnDirAll),
+                ConnEnd(Point(500, 900), ConnDirAll)));
+        for (int i = 0; i < 3; ++i)
+        {
+            conns[variant].push_back(new ConnRef(router,
+                    ConnEnd(Point(50, 600 + (i * 20)), ConnDirAll),
+                    ConnEnd(Point(300, 600 + (i * 20)), ConnDirAll)));
+        }
+        router->processTransaction();
+    }
+    routers[0]->moveShape(movingShape[0], 0, 40);
+    routers[0]->processTransaction();
+    routers[1]->moveShape(movingShape[1], 0, 40);
+    routers[1]->processTransaction(10000);
+    unsigned int kept =
+            routers[1]->transactionStatistics().total(ctRouteCacheHits);
+    routers[1]->processTransaction(10000);
+    unsigned int keptWhenRefining =
+            routers[1]->transactionStatistics().total(ctRouteCacheHits);
+    printf("Routes kept with a crossing penalty: %u, then %u.\n", kept,
+            keptWhenRefining);
+    if ((kept == 0) || (keptWhenRefining != 0) ||
+            routers[1]->refinementPending())
+    {
+        valid = false;
+    }
+    for (size_t i = 0; i < conns[0].size(); ++i)
+    {
+        if (conns[0][i]->displayRoute().ps != conns[1][i]->displayRoute().ps)
+        {
+            printf("Connector %d has a different route with a crossing "
+                    "penalty.\n", (int) i);
+            valid = false;
+        }
+    }
+    delete routers[0];
+    delete routers[1];
+
+    return valid ? 0 : 1;
+}
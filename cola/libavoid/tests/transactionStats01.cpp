@@ -0,0 +1,108 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libavoid - Fast, Incremental, Object-avoiding Line Router
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ * See the file LICENSE.LGPL distributed with the library.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * Author(s):   Adaptagrams contributors (see the version control history)
+*/
+
+// Three connectors cross in the channel between two shapes, so every
+// phase of orthogonal routing has work to count.  Then a distant shape is
+// moved with route caching on: the connectors keep their routes, which is
+// counted outside any timed phase, and no A* search is made.
+
+#include <cstdio>
+
+#include "libavoid/libavoid.h"
+using namespace Avoid;
+
+int main(void)
+{
+    Router *router = new Router(OrthogonalRouting);
+    router->setRoutingParameter(segmentPenalty, 50);
+    router->setRoutingOption(cacheOrthogonalRoutesOfUnaffectedConnectors,
+            true);
+
+    Rectangle leftRect(Point(100, 100), Point(200, 300));
+    new ShapeRef(router, leftRect);
+    Rectangle rightRect(Point(300, 100), Point(400, 300));
+    new ShapeRef(router, rightRect);
+    Rectangle farRect(Point(800, 800), Point(900, 900));
+    ShapeRef *farShape = new ShapeRef(router, farRect);
+
+    new ConnRef(router, ConnEnd(Point(220, 50), ConnDirDown),
+            ConnEnd(Point(280, 350), ConnDirUp));
+    new ConnRef(router, ConnEnd(Point(250, 50), ConnDirDown),
+            ConnEnd(Point(250, 350), ConnDirUp));
+    new ConnRef(router, ConnEnd(Point(280, 50), ConnDirDown),
+            ConnEnd(Point(220, 350), ConnDirUp));
+    router->processTransaction();
+
+    bool valid = true;
+    const TransactionStatistics& stats = router->transactionStatistics();
+    const PhaseStatistics& graph = stats.phases[tmOrthogGraph];
+    const PhaseStatistics& route = stats.phases[tmOrthogRoute];
+    const PhaseStatistics& nudge = stats.phases[tmOrthogNudge];
+    printf("Graph: %u runs, %llu ns, %u checks, %u edges.\n", graph.runs,
+            graph.nanoseconds, graph.counters[ctVisibilityChecks],
+            graph.counters[ctEdgesAdded]);
+    printf("Route: %u runs, %llu ns, %u expansions.\n", route.runs,
+            route.nanoseconds, route.counters[ctAStarExpansions]);
+    printf("Nudge: %u runs, %llu ns, %u segments, %u VPSC iterations.\n",
+            nudge.runs, nudge.nanoseconds, nudge.counters[ctNudgingSegments],
+            nudge.counters[ctVpscIterations]);
+    if ((graph.runs != 1) || (graph.counters[ctVisibilityChecks] == 0) ||
+            (graph.counters[ctEdgesAdded] == 0))
+    {
+        valid = false;
+    }
+    if ((route.runs != 1) || (route.counters[ctAStarExpansions] == 0) ||
+            (stats.total(ctAStarExpansions) !=
+             route.counters[ctAStarExpansions]))
+    {
+        valid = false;
+    }
+    if ((nudge.runs != 1) || (nudge.counters[ctNudgingSegments] < 3))
+    {
+        valid = false;
+    }
+    if ((stats.phases[tmHyperedgeForest].runs != 0) ||
+            (stats.phases[tmNon].counters[ctAStarBytesAllocated] == 0))
+    {
+        valid = false;
+    }
+
+    // The statistics only cover the latest transaction, and work done
+    // outside a timed phase is counted against tmNon.
+    router->moveShape(farShape, 0, 20);
+    router->processTransaction();
+    printf("Cache hits: %u, expansions: %u.\n",
+            stats.total(ctRouteCacheHits), stats.total(ctAStarExpansions));
+    if ((stats.phases[tmOrthogGraph].runs != 1) ||
+            (stats.phases[tmOrthogRoute].runs != 1) ||
+            (stats.total(ctAStarExpansions) != 0))
+    {
+        printf("Statistics were not reset between transactions.\n");
+        valid = false;
+    }
+    if ((stats.phases[tmNon].counters[ctRouteCacheHits] != 3) ||
+            (stats.total(ctRouteCacheHits) != 3))
+    {
+        printf("Cached routes were not counted outside the phases.\n");
+        valid = false;
+    }
+
+    delete router;
+    return valid ? 0 : 1;
+}
@@ -25,8 +25,16 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <climits>
 
+#ifdef _WIN32
+  #define WIN32_LEAN_AND_MEAN
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
 #include "libavoid/timer.h"
 #include "libavoid/debug.h"
 #include "libavoid/assertions.h"
@@ -34,6 +42,35 @@
 namespace Avoid {
 
 
+// Returns the time in nanoseconds from a clock that never goes backwards.
+static bigclock_t monotonicNanoseconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (bigclock_t) (counter.QuadPart * 
+            (1000000000.0 / frequency.QuadPart));
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((bigclock_t) now.tv_sec * 1000000000) + now.tv_nsec;
+#endif
+}
+
+
+unsigned int TransactionStatistics::total(const CounterIndex counter) const
+{
+    unsigned int sum = 0;
+    for (int i = 0; i < tmCount; ++i)
+    {
+        sum += phases[i].counters[counter];
+    }
+    return sum;
+}
+
+
 Timer::Timer()
 {
     Reset();
@@ -52,6 +89,25 @@ void Timer::Reset(void)
     running = false;
     count  = 0;
     type = lasttype = tmNon;
+    ResetTransaction();
+}
+
+
+void Timer::ResetTransaction(void)
+{
+    memset(&m_transaction, 0, sizeof(m_transaction));
+}
+
+
+const TransactionStatistics& Timer::transactionStatistics(void) const
+{
+    return m_transaction;
+}
+
+
+bigclock_t Timer::Now(void)
+{
+    return monotonicNanoseconds();
 }
 
 
@@ -77,7 +133,7 @@ void Timer::Register(const TimerIndex t, const bool start)
 void Timer::Start(void)
 {
     COLA_ASSERT(!running);
-    cStart[type] = clock();  // CPU time
+    cStart[type] = monotonicNanoseconds();
     running = true;
 }
 
@@ -85,40 +141,28 @@ void Timer::Start(void)
 void Timer::Stop(void)
 {
     COLA_ASSERT(running);
-    clock_t cStop = clock();      // CPU time
+    bigclock_t cDiff = monotonicNanoseconds() - cStart[type];
     running = false;
 
-    bigclock_t cDiff;
-    if (cStop < cStart[type])
-    {
-        // Uh-oh, the clock value has wrapped around.
-        //
-        bigclock_t realStop = ((bigclock_t) cStop) + ULONG_MAX + 1;
-        cDiff = realStop - cStart[type];
-    }
-    else
-    {
-        cDiff = cStop - cStart[type];
-    }
-    
-    COLA_ASSERT(cDiff < LONG_MAX);
+    m_transaction.phases[type].runs++;
+    m_transaction.phases[type].nanoseconds += cDiff;
 
     if (type == tmPth)
     {
         cPath[lasttype] += cDiff;
         cPathTally[lasttype]++;
-        if (((clock_t) cDiff) > cPathMax[lasttype])
+        if (cDiff > cPathMax[lasttype])
         {
-            cPathMax[lasttype] = (clock_t) cDiff;
+            cPathMax[lasttype] = cDiff;
         }
     }
     else
     {
         cTotal[type] += cDiff;
         cTally[type]++;
-        if (((clock_t) cDiff) > cMax[type])
+        if (cDiff > cMax[type])
         {
-            cMax[type] = (clock_t) cDiff;
+            cMax[type] = cDiff;
         }
         lasttype = type;
     }
@@ -136,7 +180,7 @@ void Timer::PrintAll(FILE *fp)
 }
 
 
-#define toMsec(tot) ((bigclock_t) ((tot) / (((double) CLOCKS_PER_SEC) / 1000)))
+#define toMsec(tot) ((bigclock_t) ((tot) / 1000000.0))
 #define toAvg(tot, cnt) ((((cnt) > 0) ? ((long double) (tot)) / (cnt) : 0))
 
 void Timer::Print(const TimerIndex t, FILE *fp)
@@ -26,30 +26,13 @@
 #ifndef PROFILE_H
 #define PROFILE_H
 
-#include <ctime>
+#include <cstdio>
 
 namespace Avoid {
 
-#define NOTIMERS
-
-#ifdef NOTIMERS
-
-  #define register_timer(t) do {} while(0)
-  #define regstart_timer(t) do {} while(0)
-  #define start_timer() do {} while(0)
-  #define stop_timer() do {} while(0)
-
-#else
-   
-  #define register_timer(t) router->timers.Register(t)
-  #define regstart_timer(t) router->timers.Register(t, timerStart)
-  #define start_timer() router->timers.Start()
-  #define stop_timer() router->timers.Stop()
-
-#endif
-
 typedef unsigned long long int bigclock_t;
 
+//! @brief  The phases of processing that the router times.
 enum TimerIndex 
 {
     tmNon = 0,
@@ -69,10 +52,73 @@ enum TimerIndex
 };
 
 
+//! @brief  The kinds of work that the router counts.
+enum CounterIndex
+{
+    //! @brief  Search nodes expanded by the A* connector routing search.
+    ctAStarExpansions = 0,
+    //! @brief  Visibility tests made while building visibility graphs.
+    ctVisibilityChecks,
+    //! @brief  Edges added to visibility graphs.
+    ctEdgesAdded,
+    //! @brief  Connector segments considered for orthogonal nudging.
+    ctNudgingSegments,
+    //! @brief  Constraints merged or split over by the VPSC solver 
+    //!         while nudging.
+    ctVpscIterations,
+    //! @brief  Connectors that kept their existing routes because nothing
+    //!         their route searches explored was changed.
+    ctRouteCacheHits,
+    //! @brief  Bytes of storage held for A* search nodes at the end of
+    //!         the transaction, before it is released.
+    ctAStarBytesAllocated,
+    ctCount
+};
+
+
+//! @brief  The time taken and work done in one phase of a transaction.
+struct PhaseStatistics
+{
+    //! @brief  The number of times the phase was run.
+    unsigned int runs;
+    //! @brief  The total wall-clock time spent in the phase, in 
+    //!         nanoseconds.
+    bigclock_t nanoseconds;
+    //! @brief  Counts of the work done during the phase, indexed by 
+    //!         CounterIndex.
+    unsigned int counters[ctCount];
+};
+
+
+//! @brief  The time taken and work done in each phase of the most 
+//!         recently processed transaction.
+//!
+//! Phases are indexed by TimerIndex.  Work done outside any timed phase
+//! is counted in the tmNon entry.
+//!
+//! @sa     Router::transactionStatistics()
+//!
+struct TransactionStatistics
+{
+    //! @brief  Returns the count of the given kind of work, summed over
+    //!         all phases.
+    unsigned int total(const CounterIndex counter) const;
+
+    PhaseStatistics phases[tmCount];
+};
+
+
 static const bool timerStart = true;
 static const bool timerDelay = false;
 
 
+// NOTE: This is an internal helper class that should not be used by the user.
+//
+// Times phases of the router's processing with a monotonic clock, and 
+// counts the work done in them.  Only one phase may be timed at a time.
+// Totals are kept for the life of the timer, as well as statistics for the
+// current transaction.
+//
 class Timer
 {
     public:
@@ -81,21 +127,33 @@ class Timer
         void Start(void);
         void Stop(void);
         void Reset(void);
+        void ResetTransaction(void);
         void Print(TimerIndex, FILE *fp);
         void PrintAll(FILE *fp);
+        // Counts work against the phase being timed, or against tmNon
+        // if no phase is being timed.
+        void Count(const CounterIndex counter, const unsigned int amount = 1)
+        {
+            m_transaction.phases[(running) ? type : tmNon].
+                    counters[counter] += amount;
+        }
+        const TransactionStatistics& transactionStatistics(void) const;
+        // Returns the current time in nanoseconds from the monotonic clock.
+        static bigclock_t Now(void);
 
     private:
-        clock_t cStart[tmCount];
+        bigclock_t cStart[tmCount];
         bigclock_t cTotal[tmCount];
         bigclock_t cPath[tmCount];
         int cTally[tmCount];
         int cPathTally[tmCount];
-        clock_t cMax[tmCount];
-        clock_t cPathMax[tmCount];
+        bigclock_t cMax[tmCount];
+        bigclock_t cPathMax[tmCount];
 
         bool running;
         long count;
         TimerIndex type, lasttype;
+        TransactionStatistics m_transaction;
 };
 
 
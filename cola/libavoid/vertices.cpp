@@ -25,12 +25,14 @@
 
 #include <iostream>
 #include <cstdlib>
+#include <climits>
 
 #include "libavoid/vertices.h"
 #include "libavoid/geometry.h"
 #include "libavoid/graph.h"  // For alertConns
 #include "libavoid/debug.h"
 #include "libavoid/router.h"
+#include "libavoid/blockpool.h"
 #include "libavoid/assertions.h"
 #include "libavoid/connend.h"
 
@@ -166,7 +168,9 @@ VertInf::VertInf(Router *router, const VertID& vid, const Point& vpoint,
       orthogVisListSize(0),
       invisListSize(0),
       pathNext(NULL),
+      listIndex(UINT_MAX),
       visDirections(ConnDirNone),
+      landmarkIndex(UINT_MAX),
       orthogVisPropFlags(0)
 {
     point.id = vid.objID;
@@ -185,11 +189,47 @@ VertInf::~VertInf()
 }
 
 
+void *VertInf::operator new(size_t size)
+{
+    return ::operator new(size);
+}
+
+
+void *VertInf::operator new(size_t size, Router *router)
+{
+    COLA_ASSERT(size == sizeof(VertInf));
+    return router->m_orthogonal_vertex_arena->allocate();
+}
+
+
+void VertInf::operator delete(void *ptr)
+{
+    ::operator delete(ptr);
+}
+
+
+void VertInf::operator delete(void *ptr, Router *)
+{
+    BlockPool::free(ptr);
+}
+
+
 bool VertInf::hasNeighbour(VertInf *target, bool orthogonal) const
 {
-    const EdgeInfList& visEdgeList = (orthogonal) ? orthogVisList : visList;
-    EdgeInfList::const_iterator finish = visEdgeList.end();
-    for (EdgeInfList::const_iterator edge = visEdgeList.begin(); 
+    if (orthogonal)
+    {
+        for (size_t i = 0; i < orthogVisList.size(); ++i)
+        {
+            if (orthogVisList[i]->otherVert(this) == target)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    EdgeInfList::const_iterator finish = visList.end();
+    for (EdgeInfList::const_iterator edge = visList.begin(); 
             edge != finish; ++edge)
     {
         if ((*edge)->otherVert(this) == target)
@@ -241,12 +281,11 @@ void VertInf::removeFromGraph(const bool isConnVert)
         delete (*edge);
     }
 
-    finish = orthogVisList.end();
-    while ((edge = orthogVisList.begin()) != finish)
+    while (!orthogVisList.empty())
     {
         // Remove each orthogonal visibility edge.
-        (*edge)->alertConns();
-        delete (*edge);
+        orthogVisList.front()->alertConns();
+        delete orthogVisList.front();
     }
 
     finish = invisList.end();
@@ -326,7 +365,8 @@ VertInfList::VertInfList()
       _lastShapeVert(NULL),
       _lastConnVert(NULL),
       _shapeVertices(0),
-      _connVertices(0)
+      _connVertices(0),
+      _indexLimit(0)
 {
 }
 
@@ -355,6 +395,17 @@ void VertInfList::addVertex(VertInf *vert)
     checkVertInfListConditions();
     COLA_ASSERT(vert->lstPrev == NULL);
     COLA_ASSERT(vert->lstNext == NULL);
+    COLA_ASSERT(vert->listIndex == UINT_MAX);
+
+    if (_freeIndexes.empty())
+    {
+        vert->listIndex = _indexLimit++;
+    }
+    else
+    {
+        vert->listIndex = _freeIndexes.back();
+        _freeIndexes.pop_back();
+    }
 
     if (vert->id.isConnPt())
     {
@@ -510,6 +561,12 @@ VertInf *VertInfList::removeVertex(VertInf *vert)
     vert->lstPrev = NULL;
     vert->lstNext = NULL;
 
+    if (vert->listIndex != UINT_MAX)
+    {
+        _freeIndexes.push_back(vert->listIndex);
+        vert->listIndex = UINT_MAX;
+    }
+
     checkVertInfListConditions();
 
     return following;
@@ -593,6 +650,12 @@ unsigned int VertInfList::shapesSize(void) const
 }
 
 
+unsigned int VertInfList::indexLimit(void) const
+{
+    return _indexLimit;
+}
+
+
 }
 
 
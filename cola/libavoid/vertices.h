@@ -29,6 +29,8 @@
 #include <list>
 #include <set>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <iostream>
 #include <cstdio>
 
@@ -40,6 +42,9 @@ class EdgeInf;
 class Router;
 
 typedef std::list<EdgeInf *> EdgeInfList;
+// Orthogonal vertices have only a handful of edges each, so these are kept
+// contiguously for the benefit of the searches that walk them.
+typedef std::vector<EdgeInf *> EdgeInfVector;
 
 typedef unsigned int ConnDirFlags;
 typedef unsigned short VertIDProps;
@@ -108,12 +113,21 @@ static const VertID dummyOrthogID(0, 0);
 static const VertID dummyOrthogShapeID(0, 0, VertID::PROP_OrthShapeEdge);
 
 
+// Dummy vertices of the orthogonal visibility graph are allocated from
+// the router's orthogonal graph arena, i.e., created with 
+// new (router) VertInf(router, dummyOrthogID, ...).  These must never be
+// deleted; Router::destroyOrthogonalVisGraph() destroys and reclaims them.
+//
 class VertInf
 {
     public:
         VertInf(Router *router, const VertID& vid, const Point& vpoint,
                 const bool addToRouter = true);
         ~VertInf();
+        static void *operator new(size_t size);
+        static void *operator new(size_t size, Router *router);
+        static void operator delete(void *ptr);
+        static void operator delete(void *ptr, Router *router);
         void Reset(const VertID& vid, const Point& vpoint);
         void Reset(const Point& vpoint);
         void removeFromGraph(const bool isConnVert = true);
@@ -133,18 +147,22 @@ class VertInf
         VertInf *shNext;
         EdgeInfList visList;
         unsigned int visListSize;
-        EdgeInfList orthogVisList;
+        EdgeInfVector orthogVisList;
         unsigned int orthogVisListSize;
         EdgeInfList invisList;
         unsigned int invisListSize;
         VertInf *pathNext;
 
-        // The tree root and distance value used when computing MTSTs.
-        VertInf *sptfRoot;
-        double sptfDist;
+        // A small index, unique among the vertices in the router's vertex
+        // list, for keeping per-vertex data in side arrays.  UINT_MAX if 
+        // the vertex is not in the list.
+        unsigned int listIndex;
 
         ConnDirFlags visDirections;
-        std::list<unsigned int> aStarDoneIndexes;
+        std::vector<unsigned int> aStarDoneIndexes;
+        std::vector<unsigned int> aStarPendingIndexes;
+        // The index of this vertex in the router's A* landmark distances.
+        unsigned int landmarkIndex;
         // Flags for orthogonal visibility properties, i.e., whether the 
         // line points to a shape edge, connection point or an obstacle.
         unsigned int orthogVisPropFlags;
@@ -183,6 +201,8 @@ class VertInfList
         VertInf *end(void);
         unsigned int connsSize(void) const;
         unsigned int shapesSize(void) const;
+        // An upper bound on the listIndex of every vertex in the list.
+        unsigned int indexLimit(void) const;
     private:
         VertInf *_firstShapeVert;
         VertInf *_firstConnVert;
@@ -190,10 +210,88 @@ class VertInfList
         VertInf *_lastConnVert;
         unsigned int _shapeVertices;
         unsigned int _connVertices;
+        // List indexes of removed vertices, for reuse.
+        std::vector<unsigned int> _freeIndexes;
+        unsigned int _indexLimit;
 };
 
 
-typedef std::set<unsigned int> ShapeSet;
+// The set of IDs of shapes (or clusters) containing a vertex.  Points are 
+// usually inside very few shapes, so this is kept as a small sorted vector
+// rather than a node-based std::set.  It provides the subset of the 
+// std::set interface used by the router.
+//
+class ShapeSet
+{
+    public:
+        typedef std::vector<unsigned int>::const_iterator const_iterator;
+        typedef const_iterator iterator;
+
+        const_iterator begin(void) const
+        {
+            return m_ids.begin();
+        }
+        const_iterator end(void) const
+        {
+            return m_ids.end();
+        }
+        size_t size(void) const
+        {
+            return m_ids.size();
+        }
+        bool empty(void) const
+        {
+            return m_ids.empty();
+        }
+        void clear(void)
+        {
+            m_ids.clear();
+        }
+        const_iterator find(const unsigned int id) const
+        {
+            const_iterator it = 
+                    std::lower_bound(m_ids.begin(), m_ids.end(), id);
+            return ((it != m_ids.end()) && (*it == id)) ? it : m_ids.end();
+        }
+        size_t count(const unsigned int id) const
+        {
+            return (find(id) != m_ids.end()) ? 1 : 0;
+        }
+        bool insert(const unsigned int id)
+        {
+            std::vector<unsigned int>::iterator it = 
+                    std::lower_bound(m_ids.begin(), m_ids.end(), id);
+            if ((it != m_ids.end()) && (*it == id))
+            {
+                return false;
+            }
+            m_ids.insert(it, id);
+            return true;
+        }
+        template <typename InputIterator>
+        void insert(InputIterator first, InputIterator last)
+        {
+            for (InputIterator curr = first; curr != last; ++curr)
+            {
+                insert(*curr);
+            }
+        }
+        size_t erase(const unsigned int id)
+        {
+            std::vector<unsigned int>::iterator it = 
+                    std::lower_bound(m_ids.begin(), m_ids.end(), id);
+            if ((it == m_ids.end()) || (*it != id))
+            {
+                return 0;
+            }
+            m_ids.erase(it);
+            return 1;
+        }
+
+    private:
+        std::vector<unsigned int> m_ids;
+};
+
 typedef std::map<VertID, ShapeSet> ContainsMap;
 
 
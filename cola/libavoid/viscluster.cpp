@@ -28,6 +28,7 @@
 #include "libavoid/router.h"
 #include "libavoid/assertions.h"
 #include "libavoid/debug.h"
+#include "libavoid/bboxindex.h"
 
 
 namespace Avoid {
@@ -64,6 +65,7 @@ void ClusterRef::makeActive(void)
     // Add to clusterRefs list.
     m_clusterrefs_pos = m_router->clusterRefs.insert(
             m_router->clusterRefs.begin(), this);
+    m_router->m_cluster_bbox_index->invalidate();
 
     m_active = true;
 }
@@ -75,6 +77,7 @@ void ClusterRef::makeInactive(void)
     
     // Remove from clusterRefs list.
     m_router->clusterRefs.erase(m_clusterrefs_pos);
+    m_router->m_cluster_bbox_index->invalidate();
 
     m_active = false;
 }
@@ -82,8 +85,10 @@ void ClusterRef::makeInactive(void)
 
 void ClusterRef::setNewPoly(Polygon& poly)
 {
+    m_router->waitForAsyncTransactions();
     m_polygon = ReferencingPolygon(poly, m_router);
     m_rectangular_polygon = m_polygon.boundingRect();
+    m_router->m_cluster_bbox_index->invalidate();
 }
 
 
@@ -599,7 +599,7 @@ void vertexSweep(VertInf *vert)
         EdgeInf *edge = EdgeInf::existingEdge(centerInf, currInf);
         if (edge == NULL)
         {
-            edge = new EdgeInf(centerInf, currInf);
+            edge = new (centerInf->_router) EdgeInf(centerInf, currInf);
         }
 
         for (SweepEdgeList::iterator c = e.begin(); c != e.end(); ++c)
@@ -59,6 +59,7 @@ IncSolver::IncSolver(vector<Variable*> const &vs, vector<Constraint *> const &cs
       n(vs.size()), 
       vs(vs) 
 {
+    iterationCnt=0;
     for(unsigned i=0;i<n;++i) {
         vs[i]->in.clear();
         vs[i]->out.clear();
@@ -261,6 +262,7 @@ bool IncSolver::satisfy() {
             (v->equality || ((v->slack() < ZERO_UPPERBOUND) && !v->active)) )
     {
         COLA_ASSERT(!v->active);
+        iterationCnt++;
         Block *lb = v->left->block, *rb = v->right->block;
         if(lb != rb) {
             lb->merge(rb,v);
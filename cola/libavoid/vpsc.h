@@ -225,6 +225,7 @@ struct UnsatisfiedConstraint {
 class IncSolver {
 public:
     unsigned splitCnt;
+    unsigned iterationCnt;
     bool satisfy();
     bool solve();
     void moveBlocks();
@@ -458,14 +458,9 @@ void ConstrainedMajorizationLayout::straighten(vector<straightener::Edge*>& sedg
         startCoords=&startY;
     }
     vector<straightener::Node*> snodes;
-    if(dim==HORIZONTAL) {
-        Rectangle::setXBorder(0.0001);
-    }
+    const double xBorder=dim==HORIZONTAL?0.0001:0;
     for (unsigned i=0;i<n;i++) {
-        snodes.push_back(new straightener::Node(i,boundingBoxes[i]));
-    }
-    if(dim==HORIZONTAL) {
-        Rectangle::setXBorder(0);
+        snodes.push_back(new straightener::Node(i,boundingBoxes[i],xBorder));
     }
     for (unsigned i=n;i<gp->getNumStaticVars();i++) {
         // insert some dummy nodes
@@ -65,6 +65,7 @@ GradientProjection::GradientProjection(
         : k(k), 
           denseSize(static_cast<unsigned>((floor(sqrt(static_cast<double>(denseQ->size())))))),
           denseQ(denseQ), 
+          staticQ(NULL),
           rs(rs),
           ccs(ccs),
           unsatisfiableConstraints(unsatisfiableConstraints),
@@ -76,14 +77,46 @@ GradientProjection::GradientProjection(
           solveWithMosek(solveWithMosek),
           scaling(scaling)
 {
+    setup();
+}
+GradientProjection::GradientProjection(
+    const Dim k,
+    cola::SparseMatrix const *Q,
+    const double tol,
+    const unsigned max_iterations,
+    CompoundConstraints const *ccs,
+    UnsatisfiableConstraintInfos *unsatisfiableConstraints,
+    NonOverlapConstraintsMode nonOverlapConstraints,
+    RootCluster* clusterHierarchy,
+    vpsc::Rectangles* rs,
+    const bool scaling,
+    SolveWithMosek solveWithMosek) 
+        : k(k), 
+          denseSize(Q->rowSize()),
+          denseQ(NULL), 
+          staticQ(Q),
+          rs(rs),
+          ccs(ccs),
+          unsatisfiableConstraints(unsatisfiableConstraints),
+          nonOverlapConstraints(nonOverlapConstraints),
+          clusterHierarchy(clusterHierarchy),
+          tolerance(tol), 
+          max_iterations(max_iterations),
+          sparseQ(NULL),
+          solveWithMosek(solveWithMosek),
+          scaling(scaling)
+{
+    setup();
+}
+void GradientProjection::setup() {
     printf("GP Instance: scaling=%d, mosek=%d\n",scaling,solveWithMosek);
     for(unsigned i=0;i<denseSize;i++) {
         vars.push_back(new vpsc::Variable(i,1,1));
     }
     if(scaling) {
-        scaledDenseQ.resize(denseSize*denseSize);
         for(unsigned i=0;i<denseSize;i++) {
-            vars[i]->scale=1./sqrt(fabs((*denseQ)[i*denseSize+i]));
+            double qii=denseQ?(*denseQ)[i*denseSize+i]:staticQ->getIJ(i,i);
+            vars[i]->scale=1./sqrt(fabs(qii));
             // XXX: Scale can sometimes be set to infinity here when 
             //      there are nodes not connected to any other node.
             //      Thus we just set the scale for such a variable to 1.
@@ -92,8 +125,12 @@ GradientProjection::GradientProjection(
                 vars[i]->scale = 1;
             }
         }
+    }
+    if(scaling && denseQ) {
         // the following computes S'QS for Q=denseQ
         // and S is diagonal matrix of scale factors
+        // (a sparse Q is scaled on the fly, see multiplyQ())
+        scaledDenseQ.resize(denseSize*denseSize);
         for(unsigned i=0;i<denseSize;i++) {
             for(unsigned j=0;j<denseSize;j++) {
                 scaledDenseQ[i*denseSize+j]=(*denseQ)[i*denseSize+j]*vars[i]->scale
@@ -134,23 +171,50 @@ static inline double dotProd(valarray<double> const & a, valarray<double> const
     }
     return p;
 }
+// r = A x, where A = Q + sparseQ and Q is either denseQ or staticQ
+// (scaled as S'QS when scaling).  Q covers only the first denseSize
+// variables, any dummy variables beyond those only appear in sparseQ.
+void GradientProjection::multiplyQ(
+        valarray<double> const &x,
+        valarray<double> &r) const {
+    COLA_ASSERT(x.size()==r.size());
+    if(scratch.size()!=x.size()) {
+        scratch.resize(x.size());
+    }
+    if(denseQ) {
+        for (unsigned i=0; i<denseSize; i++) {
+            double sum = 0;
+            for (unsigned j=0; j<denseSize; j++) {
+                sum += (*denseQ)[i*denseSize+j]*x[j];
+            }
+            r[i] = sum;
+        }
+    } else if(scaling) {
+        for (unsigned i=0; i<denseSize; i++) {
+            scratch[i] = vars[i]->scale*x[i];
+        }
+        staticQ->rightMultiply(scratch,r);
+        for (unsigned i=0; i<denseSize; i++) {
+            r[i] *= vars[i]->scale;
+        }
+    } else {
+        staticQ->rightMultiply(x,r);
+    }
+    for (unsigned i=denseSize; i<r.size(); i++) {
+        r[i] = 0;
+    }
+    if(sparseQ) {
+        sparseQ->rightMultiply(x,scratch);
+        r+=scratch;
+    }
+}
 double GradientProjection::computeCost(
         valarray<double> const &b,
         valarray<double> const &x) const {
     // computes cost = 2 b x - x A x
     double cost = 2. * dotProd(b,x);
     valarray<double> Ax(x.size());
-    for (unsigned i=0; i<denseSize; i++) {
-        Ax[i] = 0;
-        for (unsigned j=0; j<denseSize; j++) {
-            Ax[i] += (*denseQ)[i*denseSize+j]*x[j];
-        }
-    }
-    if(sparseQ) {
-        valarray<double> r(x.size());
-        sparseQ->rightMultiply(x,r);
-        Ax+=r;
-    }
+    multiplyQ(x,Ax);
     return cost - dotProd(x,Ax);
 }
 
@@ -160,24 +224,17 @@ double GradientProjection::computeSteepestDescentVector(
         valarray<double> &g) const {
     // find steepest descent direction
     //  g = 2 ( b - A x )
-    //    where: A = denseQ + sparseQ
-    //  g = 2 ( b - denseQ x) - 2 sparseQ x
+    //    where: A = Q + sparseQ, see multiplyQ()
     //
     //  except the 2s don't matter because we compute 
     //  the optimal stepsize anyway
     COLA_ASSERT(x.size()==b.size() && b.size()==g.size());
-    g = b;
-    for (unsigned i=0; i<denseSize; i++) {
-        for (unsigned j=0; j<denseSize; j++) {
-            g[i] -= (*denseQ)[i*denseSize+j]*x[j];
-        }
-    }
-    // sparse part:
-    if(sparseQ) {
-        valarray<double> r(x.size());
-        sparseQ->rightMultiply(x,r);
-        g-=r;
+    if(product.size()!=x.size()) {
+        product.resize(x.size());
     }
+    multiplyQ(x,product);
+    g = b;
+    g -= product;
     return computeStepSize(g,g);
 }
 // compute optimal step size along descent vector d relative to
@@ -186,20 +243,12 @@ double GradientProjection::computeSteepestDescentVector(
 double GradientProjection::computeStepSize(
         valarray<double> const & g, valarray<double> const & d) const {
     COLA_ASSERT(g.size()==d.size());
-    valarray<double> Ad;
-    if(sparseQ) {
-        Ad.resize(g.size());
-        sparseQ->rightMultiply(d,Ad);
+    if(product.size()!=d.size()) {
+        product.resize(d.size());
     }
+    multiplyQ(d,product);
     double const numerator = dotProd(g, d);
-    double denominator = 0;
-    for (unsigned i=0; i<g.size(); i++) {
-        double r = sparseQ ? Ad[i] : 0;
-        if(i<denseSize) { for (unsigned j=0; j<denseSize; j++) {
-            r += (*denseQ)[i*denseSize+j] * d[j];
-        } }
-        denominator += r * d[i];
-    }
+    double const denominator = dotProd(product, d);
     if(denominator==0) {
         return 0;
     }
@@ -318,10 +367,11 @@ unsigned GradientProjection::solve(
             stepSize+=step*step;
             COLA_ASSERT(!isNaN(result[i]));
             COLA_ASSERT(isFinite(result[i]));
-            if(!vars[i]->fixedDesiredPosition) vars[i]->desiredPosition=result[i];
         }
 
-        //project to constraint boundary
+        //project to constraint boundary, starting from the blocks left
+        //by the previous projection
+        solver->updateDesiredPositions(result);
         bool constrainedOptimum = false;
         constrainedOptimum=runSolver(result);
         stepSize=0;
@@ -392,13 +442,11 @@ IncSolver* GradientProjection::setupVPSC() {
             if(k==HORIZONTAL) {
                 // Make rectangles a little bit wider when processing horizontally so that any overlap
                 // resolved horizontally is strictly non-overlapping when processing vertically
-                Rectangle::setXBorder(0.0001);
                 // use rs->size() rather than n because some of the variables may
                 // be dummy vars with no corresponding rectangle
-                generateXConstraints(*rs,vars,lcs,nonOverlapConstraints==Both?true:false); 
-                Rectangle::setXBorder(0);
+                generateXConstraints(*rs,vars,lcs,nonOverlapConstraints==Both?true:false,0.0001,0);
             } else {
-                generateYConstraints(*rs,vars,lcs); 
+                generateYConstraints(*rs,vars,lcs,0,0);
             }
         }
     }
@@ -417,7 +465,7 @@ IncSolver* GradientProjection::setupVPSC() {
             unsigned k=0;
             for(unsigned i=0;i<n;i++) {
                 for(unsigned j=i;j<n;j++) {
-                    lap[k]=(*denseQ)[i*n+j];
+                    lap[k]=denseQ?(*denseQ)[i*n+j]:staticQ->getIJ(i,j);
                     k++;
                 }
             }
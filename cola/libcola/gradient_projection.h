@@ -73,6 +73,24 @@ public:
         vpsc::Rectangles* rs = NULL,
         const bool scaling = false,
         SolveWithMosek solveWithMosek = Off);
+    /**
+     * As above, but with Q given as a sparse (CSR) matrix instead of
+     * denseQ, so that each iteration costs time proportional to the
+     * number of nonzeros in Q rather than to its square size.  Q (and the
+     * SparseMap it was built from) must outlive this instance.
+     */
+    GradientProjection(
+        const vpsc::Dim k,
+        cola::SparseMatrix const *Q,
+        const double tol,
+        const unsigned max_iterations,
+        CompoundConstraints const *ccs,
+        UnsatisfiableConstraintInfos *unsatisfiableConstraints,
+        NonOverlapConstraintsMode nonOverlapConstraints = None,
+        RootCluster* clusterHierarchy = NULL,
+        vpsc::Rectangles* rs = NULL,
+        const bool scaling = false,
+        SolveWithMosek solveWithMosek = Off);
     static void dumpSquareMatrix(std::valarray<double> const &L) {
         unsigned n=static_cast<unsigned>(floor(sqrt(static_cast<double>(L.size()))));
         printf("Matrix %dX%d\n{",n,n);
@@ -123,6 +141,9 @@ public:
         return result;
     }
 private:
+    void setup();
+    void multiplyQ(std::valarray<double> const &x,
+        std::valarray<double> &r) const;
     vpsc::IncSolver* setupVPSC();
     double computeCost(std::valarray<double> const &b,
         std::valarray<double> const &x) const;
@@ -139,8 +160,9 @@ private:
     vpsc::Dim k;
     unsigned numStaticVars; // number of variables that persist
                               // throughout iterations
-    const unsigned denseSize; // denseQ has denseSize^2 entries
+    const unsigned denseSize; // number of rows of denseQ or staticQ
     std::valarray<double> *denseQ; // dense square graph laplacian matrix
+    cola::SparseMatrix const * staticQ; // sparse alternative to denseQ
     std::valarray<double> scaledDenseQ; // scaled dense square graph laplacian matrix
     std::vector<vpsc::Rectangle*>* rs;
     CompoundConstraints const *ccs;
@@ -157,6 +179,8 @@ private:
     vpsc::Constraints lcs; /* local constraints - only for current iteration */
     vpsc::Constraints cs; /* working list of constraints: gcs +lcs */
     std::valarray<double> result;
+    mutable std::valarray<double> product; // Q products, reused
+    mutable std::valarray<double> scratch; //   across iterations
 #ifdef MOSEK_AVAILABLE
     MosekEnv* menv;
 #endif
@@ -256,14 +256,18 @@ public:
                  // a violated constraint
     bool open; // a node is opened (if scan is true) when the scanline first reaches
                // its boundary and closed when the scanline leaves it.
-    Node(unsigned id, vpsc::Rectangle const * r) :
+    // The extent of r is taken with xBorder and yBorder added on each
+    // side, rather than the static vpsc::Rectangle borders.
+    Node(unsigned id, vpsc::Rectangle const * r,
+            const double xBorder=0, const double yBorder=0) :
         ScanObject(id),cluster(NULL),
         edge(NULL),dummy(false),scan(true),active(true),open(false) { 
             for(unsigned i=0;i<2;i++) {
+                const double border=i==0?xBorder:yBorder;
                 pos[i]=r->getCentreD(i);
-                min[i]=r->getMinD(i);
-                max[i]=r->getMaxD(i);
-                length[i]=r->length(i);
+                min[i]=r->getMinD(i,border);
+                max[i]=r->getMaxD(i,border);
+                length[i]=max[i]-min[i];
             }
     }
     Node(unsigned id, const double x, const double y) :
@@ -0,0 +1,92 @@
+// Checks that GradientProjection gives the same result whether the goal
+// matrix is passed densely or as a sparse (CSR) matrix, with and without
+// scaling, and prints the time taken by each.
+#include <vector>
+#include <valarray>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include "libcola/cola.h"
+#include "libcola/gradient_projection.h"
+using namespace cola;
+using std::valarray;
+
+static double elapsedMs(const clock_t start) {
+    return 1000.0*(clock()-start)/CLOCKS_PER_SEC;
+}
+
+// Laplacian of a grid graph plus the identity, in both forms.
+static void makeQ(const unsigned side, valarray<double> &dense, SparseMap &sparse) {
+    const unsigned n=side*side;
+    dense.resize(n*n,0);
+    sparse.resize(n);
+    for(unsigned i=0;i<n;i++) {
+        dense[i*n+i]+=1;
+        sparse(i,i)+=1;
+        unsigned neighbours[2]={i+1,i+side};
+        for(unsigned k=0;k<2;k++) {
+            unsigned j=neighbours[k];
+            if(j>=n || (k==0 && j%side==0)) continue;
+            dense[i*n+i]+=1; dense[j*n+j]+=1;
+            dense[i*n+j]-=1; dense[j*n+i]-=1;
+            sparse(i,i)+=1; sparse(j,j)+=1;
+            sparse(i,j)-=1; sparse(j,i)-=1;
+        }
+    }
+}
+
+static bool compare(const unsigned side, const bool scaling) {
+    const unsigned n=side*side;
+    valarray<double> dense;
+    SparseMap sparseMap;
+    makeQ(side,dense,sparseMap);
+    SparseMatrix sparse(sparseMap);
+    srand(1);
+    valarray<double> b(n);
+    for(unsigned i=0;i<n;i++) {
+        b[i]=rand()%1000;
+    }
+    std::vector<vpsc::Rectangle*> rs;
+    CompoundConstraints ccs;
+    for(unsigned i=0;i+1<n;i+=3) {
+        ccs.push_back(new SeparationConstraint(vpsc::HORIZONTAL,i,i+1,20));
+    }
+    valarray<double> x[2];
+    double ms[2];
+    for(int variant=0;variant<2;variant++) {
+        x[variant].resize(n,0);
+        clock_t t=clock();
+        GradientProjection *gp = variant==0
+            ? new GradientProjection(vpsc::HORIZONTAL,&dense,0.0001,100,
+                    &ccs,NULL,None,NULL,&rs,scaling)
+            : new GradientProjection(vpsc::HORIZONTAL,&sparse,0.0001,100,
+                    &ccs,NULL,None,NULL,&rs,scaling);
+        gp->solve(b,x[variant]);
+        ms[variant]=elapsedMs(t);
+        delete gp;
+    }
+    for(unsigned i=0;i<ccs.size();i++) {
+        delete ccs[i];
+    }
+    bool ok=true;
+    for(unsigned i=0;i<n;i++) {
+        if(fabs(x[0][i]-x[1][i])>0.001*(1+fabs(x[0][i]))) {
+            printf("  x[%d]: dense %f, sparse %f\n",i,x[0][i],x[1][i]);
+            ok=false;
+            break;
+        }
+    }
+    printf("n=%d scaling=%d: dense Q %.1fms, sparse Q %.1fms\n",
+            n,scaling,ms[0],ms[1]);
+    return ok;
+}
+
+int main() {
+    bool ok=compare(10,false);
+    ok=compare(10,true) && ok;
+    ok=compare(40,false) && ok;
+    return ok?0:1;
+}
+
+// vim: filetype=cpp:expandtab:shiftwidth=4:tabstop=4:softtabstop=4 :
@@ -35,10 +35,11 @@
 #include "libvpsc/block.h"
 #include "libvpsc/variable.h"
 #include <cassert>
-#include "libvpsc/pairing_heap.h"
+#include <algorithm>
 #include "libvpsc/constraint.h"
 #include "libvpsc/exceptions.h"
 #include "libvpsc/blocks.h"
+#include "libvpsc/assertions.h"
 
 #ifdef LIBVPSC_LOGGING
 #include <fstream>
@@ -50,6 +51,30 @@ using std::endl;
 #define __NOTNAN(p) (p)==(p)
 
 namespace vpsc {
+// std heaps keep the greatest element first.
+struct GreaterConstraint {
+    bool operator()(Constraint *const &l, Constraint *const &r) const {
+        return CompareConstraints()(r,l);
+    }
+};
+void ConstraintHeap::insert(Constraint *c) {
+    items.push_back(c);
+    std::push_heap(items.begin(),items.end(),GreaterConstraint());
+}
+void ConstraintHeap::deleteMin() {
+    std::pop_heap(items.begin(),items.end(),GreaterConstraint());
+    items.pop_back();
+}
+void ConstraintHeap::merge(ConstraintHeap &other) {
+    // The slacks of the constraints in the two heaps have changed by
+    // different amounts since each was ordered, so reorder the union.
+    if(other.items.size()>items.size()) {
+        items.swap(other.items);
+    }
+    items.insert(items.end(),other.items.begin(),other.items.end());
+    other.items.clear();
+    std::make_heap(items.begin(),items.end(),GreaterConstraint());
+}
 void PositionStats::addVariable(Variable* v) {
     double ai=scale/v->scale;
     double bi=v->offset/v->scale;
@@ -90,8 +115,7 @@ Block::Block(Blocks *blocks, Variable* const v)
     //, wposn(0)
     , deleted(false)
     , timeStamp(0)
-    , in(NULL)
-    , out(NULL)
+    , index((size_t)-1)
     , blocks(blocks)
 {
     if(v!=NULL) {
@@ -117,8 +141,6 @@ void Block::updateWeightedPosition() {
 Block::~Block(void)
 {
     delete vars;
-    delete in;
-    delete out;
 }
 void Block::setUpInConstraints() {
     setUpConstraintHeap(in,true);
@@ -126,9 +148,8 @@ void Block::setUpInConstraints() {
 void Block::setUpOutConstraints() {
     setUpConstraintHeap(out,false);
 }
-void Block::setUpConstraintHeap(PairingHeap<Constraint*,CompareConstraints>* &h,bool in) {
-    delete h;
-    h = new PairingHeap<Constraint*,CompareConstraints>();
+void Block::setUpConstraintHeap(ConstraintHeap &h,bool in) {
+    h.reset();
     for (Vit i=vars->begin();i!=vars->end();++i) {
         Variable *v=*i;
         std::vector<Constraint*> *cs=in?&(v->in):&(v->out);
@@ -138,7 +159,7 @@ void Block::setUpConstraintHeap(PairingHeap<Constraint*,CompareConstraints>* &h,
             if ( ((c->left->block != this) && in) || 
                  ((c->right->block != this) && !in) )
             {
-                h->insert(c);
+                h.insert(c);
             }
         }
     }
@@ -208,21 +229,24 @@ void Block::mergeIn(Block *b) {
     // We check the top of the heaps to remove possible internal constraints
     findMinInConstraint();
     b->findMinInConstraint();
-    in->merge(b->in);
+    in.merge(b->in);
 #ifdef LIBVPSC_LOGGING
-    f<<"  merged heap: "<<*in<<endl;
+    f<<"  merged heap: "<<in.items.size()<<" constraints"<<endl;
 #endif
 }
 void Block::mergeOut(Block *b) {    
     findMinOutConstraint();
     b->findMinOutConstraint();
-    out->merge(b->out);
+    out.merge(b->out);
 }
 Constraint *Block::findMinInConstraint() {
+    if(!in.isSetUp()) {
+        setUpInConstraints();
+    }
     Constraint *v = NULL;
     std::vector<Constraint*> outOfDate;
-    while (!in->isEmpty()) {
-        v = in->findMin();
+    while (!in.isEmpty()) {
+        v = in.findMin();
         Block *lb=v->left->block;
         Block *rb=v->right->block;
         // rb may not be this if called between merge and mergeIn
@@ -240,13 +264,13 @@ Constraint *Block::findMinInConstraint() {
                 f<<"     rb="<<*rb<<endl;
             }
 #endif
-            in->deleteMin();
+            in.deleteMin();
 #ifdef LIBVPSC_LOGGING
             f<<" ... skipping internal constraint"<<endl;
 #endif
         } else if(v->timeStamp < lb->timeStamp) {
             // block at other end of constraint has been moved since this
-            in->deleteMin();
+            in.deleteMin();
             outOfDate.push_back(v);
 #ifdef LIBVPSC_LOGGING
             f<<"    reinserting out of date (reinsert later)"<<endl;
@@ -258,35 +282,38 @@ Constraint *Block::findMinInConstraint() {
     for(Cit i=outOfDate.begin();i!=outOfDate.end();++i) {
         v=*i;
         v->timeStamp=blocks->blockTimeCtr;
-        in->insert(v);
+        in.insert(v);
     }
-    if(in->isEmpty()) {
+    if(in.isEmpty()) {
         v=NULL;
     } else {
-        v=in->findMin();
+        v=in.findMin();
     }
     return v;
 }
 Constraint *Block::findMinOutConstraint() {
-    if(out->isEmpty()) return NULL;
-    Constraint *v = out->findMin();
+    if(!out.isSetUp()) {
+        setUpOutConstraints();
+    }
+    if(out.isEmpty()) return NULL;
+    Constraint *v = out.findMin();
     while (v->left->block == v->right->block) {
-        out->deleteMin();
-        if(out->isEmpty()) return NULL;
-        v = out->findMin();
+        out.deleteMin();
+        if(out.isEmpty()) return NULL;
+        v = out.findMin();
     }
     return v;
 }
 void Block::deleteMinInConstraint() {
-    in->deleteMin();
+    in.deleteMin();
 #ifdef LIBVPSC_LOGGING
     ofstream f(LOGFILE,ios::app);
     f<<"deleteMinInConstraint... "<<endl;
-    f<<"  result: "<<*in<<endl;
+    f<<"  result: "<<in.items.size()<<" constraints"<<endl;
 #endif
 }
 void Block::deleteMinOutConstraint() {
-    out->deleteMin();
+    out.deleteMin();
 }
 inline bool Block::canFollowLeft(Constraint const* c, Variable const* last) const {
     return c->left->block==this && c->active && last!=c->left;
@@ -617,10 +644,10 @@ Constraint* Block::splitBetween(Variable* const vl, Variable* const vr,
  */
 void Block::split(Block* &l, Block* &r, Constraint* c) {
     c->active=false;
-    l=new Block(blocks);
+    l=blocks->createBlock();
     populateSplitBlock(l,c->left,c->right);
     //COLA_ASSERT(l->weight>0);
-    r=new Block(blocks);
+    r=blocks->createBlock();
     populateSplitBlock(r,c->right,c->left);
     //COLA_ASSERT(r->weight>0);
 }
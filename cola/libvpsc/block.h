@@ -35,17 +35,40 @@
 #ifndef SEEN_LIBVPSC_BLOCK_H
 #define SEEN_LIBVPSC_BLOCK_H
 
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
-template <class T, class TCompare> class PairingHeap;
-
 namespace vpsc {
 class Variable;
 class Constraint;
 class CompareConstraints;
 class Blocks;
 
+/**
+ * A binary heap of the constraints entering or leaving a block, least
+ * first by CompareConstraints.  It is held in a vector, so once that has
+ * grown, inserting and merging do not allocate; Blocks also hands the
+ * vectors of destroyed blocks on to new ones.
+ */
+class ConstraintHeap {
+public:
+	ConstraintHeap() : setUp(false) {}
+	// False until the block first sets up this heap.
+	bool isSetUp() const { return setUp; }
+	// Empties the heap, ready to be filled for the block.
+	void reset() { items.clear(); setUp=true; }
+	bool isEmpty() const { return items.empty(); }
+	Constraint *findMin() const { return items.front(); }
+	void insert(Constraint *c);
+	void deleteMin();
+	// Moves all the constraints from other into this heap.
+	void merge(ConstraintHeap &other);
+	std::vector<Constraint*> items;
+private:
+	bool setUp;
+};
+
 struct PositionStats {
 	PositionStats() : scale(0), AB(0), AD(0), A2(0) {}
 	void addVariable(Variable* const v);
@@ -90,8 +113,11 @@ public:
 	double cost();
 	bool deleted;
 	long timeStamp;
-	PairingHeap<Constraint*,CompareConstraints> *in;
-	PairingHeap<Constraint*,CompareConstraints> *out;
+	// Position in Blocks, see Blocks::insert().
+	size_t index;
+	// Set up on demand by setUpInConstraints(), findMinInConstraint() etc.
+	ConstraintHeap in;
+	ConstraintHeap out;
 	bool getActivePathBetween(Constraints& path, Variable const* u,
 	       	Variable const* v, Variable const *w) const;
 	bool isActiveDirectedPathBetween(
@@ -110,7 +136,7 @@ private:
 	bool canFollowRight(Constraint const* c, Variable const* last) const;
 	void populateSplitBlock(Block *b, Variable* v, Variable const* u);
 	void addVariable(Variable* v);
-	void setUpConstraintHeap(PairingHeap<Constraint*,CompareConstraints>* &h,bool in);
+	void setUpConstraintHeap(ConstraintHeap &h,bool in);
 
     // Parent container, that holds the blockTimeCtr.
     Blocks *blocks;
@@ -35,6 +35,7 @@
  */
 
 #include <cassert>
+#include <new>
 #include "libvpsc/blocks.h"
 #include "libvpsc/block.h"
 #include "libvpsc/constraint.h"
@@ -47,7 +48,6 @@ using std::ios;
 using std::ofstream;
 using std::endl;
 #endif
-using std::set;
 using std::vector;
 using std::iterator;
 using std::list;
@@ -57,19 +57,79 @@ using std::copy;
 namespace vpsc {
 
 
-Blocks::Blocks(vector<Variable*> const &vs) : vs(vs),nvs(vs.size()) {
+static const size_t blocksPerChunk=256;
+
+Blocks::Blocks(vector<Variable*> const &vs) 
+    : vs(vs)
+    , nvs(vs.size())
+    , count(0)
+    , arenaChunkUsed(blocksPerChunk) {
     blockTimeCtr=0;
+    store.reserve(nvs);
     for(int i=0;i<nvs;i++) {
-        insert(new Block(this, vs[i]));
+        insert(createBlock(vs[i]));
     }
 }
 Blocks::~Blocks(void)
 {
     blockTimeCtr=0;
-    for(set<Block*>::iterator i=begin();i!=end();++i) {
-        delete *i;
+    for(const_iterator i=begin();i!=end();++i) {
+        destroyBlock(*i);
+    }
+    for(vector<char*>::iterator i=arenaChunks.begin();i!=arenaChunks.end();++i) {
+        ::operator delete(*i);
+    }
+}
+Block *Blocks::createBlock(Variable* const v) {
+    void *mem;
+    if(!arenaFree.empty()) {
+        mem=arenaFree.back();
+        arenaFree.pop_back();
+    } else {
+        if(arenaChunkUsed==blocksPerChunk) {
+            arenaChunks.push_back(
+                    (char*)::operator new(sizeof(Block)*blocksPerChunk));
+            arenaChunkUsed=0;
+        }
+        mem=arenaChunks.back()+sizeof(Block)*arenaChunkUsed++;
+    }
+    Block *b=new(mem) Block(this,v);
+    if(heapBuffers.size()>=2) {
+        b->in.items.swap(heapBuffers.back());
+        heapBuffers.pop_back();
+        b->out.items.swap(heapBuffers.back());
+        heapBuffers.pop_back();
+    }
+    return b;
+}
+void Blocks::destroyBlock(Block *b) {
+    if(b->in.items.capacity()>0 && b->out.items.capacity()>0) {
+        heapBuffers.resize(heapBuffers.size()+2);
+        heapBuffers[heapBuffers.size()-1].swap(b->in.items);
+        heapBuffers[heapBuffers.size()-2].swap(b->out.items);
+    }
+    b->~Block();
+    arenaFree.push_back(b);
+}
+void Blocks::insert(Block *b) {
+    if(b->index<store.size() && store[b->index]==b) {
+        return;
+    }
+    if(freeSlots.empty()) {
+        b->index=store.size();
+        store.push_back(b);
+    } else {
+        b->index=freeSlots.back();
+        freeSlots.pop_back();
+        store[b->index]=b;
     }
-    clear();
+    ++count;
+}
+void Blocks::erase(Block *b) {
+    COLA_ASSERT(b->index<store.size() && store[b->index]==b);
+    store[b->index]=NULL;
+    freeSlots.push_back(b->index);
+    --count;
 }
 
 /**
@@ -123,7 +183,7 @@ void Blocks::mergeLeft(Block *r) {
 #endif
         r->deleteMinInConstraint();
         Block *l = c->left->block;        
-        if (l->in==NULL) l->setUpInConstraints();
+        if (!l->in.isSetUp()) l->setUpInConstraints();
         double dist = c->right->offset - c->left->offset - c->gap;
         if (r->vars->size() < l->vars->size()) {
             dist=-dist;
@@ -176,13 +236,25 @@ void Blocks::removeBlock(Block *doomed) {
     //erase(doomed);
 }
 void Blocks::cleanup() {
-    vector<Block*> bcopy(begin(),end());
-    for(vector<Block*>::iterator i=bcopy.begin();i!=bcopy.end();++i) {
-        Block *b=*i;
-        if(b->deleted) {
+    for(size_t i=0;i<store.size();++i) {
+        Block *b=store[i];
+        if(b!=NULL && b->deleted) {
             erase(b);
-            delete b;
+            destroyBlock(b);
+        }
+    }
+    // Once most slots are empty, close the gaps (keeping the order) so
+    // that iteration stays proportional to the number of blocks.
+    if(freeSlots.size()>count) {
+        size_t j=0;
+        for(size_t i=0;i<store.size();++i) {
+            if(store[i]!=NULL) {
+                store[i]->index=j;
+                store[j++]=store[i];
+            }
         }
+        store.resize(j);
+        freeSlots.clear();
     }
 }
 /**
@@ -218,7 +290,7 @@ void Blocks::split(Block *b, Block *&l, Block *&r, Constraint *c) {
  */
 double Blocks::cost() {
     double c = 0;
-    for(set<Block*>::iterator i=begin();i!=end();++i) {
+    for(const_iterator i=begin();i!=end();++i) {
         c += (*i)->cost();
     }
     return c;
@@ -41,7 +41,7 @@
 #define LOGFILE "libvpsc.log"
 #endif
 
-#include <set>
+#include <cstddef>
 #include <list>
 #include <vector>
 
@@ -52,11 +52,38 @@ class Constraint;
 /**
  * A block structure defined over the variables such that each block contains
  * 1 or more variables, with the invariant that all constraints inside a block
- * are satisfied by keeping the variables fixed relative to one another
+ * are satisfied by keeping the variables fixed relative to one another.
+ *
+ * Blocks are kept in a vector at stable indices (Block::index), with the
+ * slots of erased blocks kept on a free list for reuse, so insertion and
+ * removal are O(1) and iteration follows index order, which depends only
+ * on the sequence of operations and not on where blocks were allocated.
  */
-class Blocks : public std::set<Block*>
+class Blocks
 {
 public:
+	/**
+	 * Visits the blocks in index order.  Iterators stay valid when blocks
+	 * are inserted, and blocks inserted in new slots while iterating are
+	 * visited.
+	 */
+	class const_iterator {
+	public:
+		const_iterator(std::vector<Block*> const &store, size_t i)
+			: store(&store), i(i) { skipEmpty(); }
+		Block *operator*() const { return (*store)[i]; }
+		const_iterator& operator++() { ++i; skipEmpty(); return *this; }
+		bool operator==(const const_iterator& o) const { return i==o.i; }
+		bool operator!=(const const_iterator& o) const { return i!=o.i; }
+	private:
+		void skipEmpty() {
+			while(i<store->size() && (*store)[i]==NULL) ++i;
+		}
+		std::vector<Block*> const *store;
+		size_t i;
+	};
+	typedef const_iterator iterator;
+
 	Blocks(std::vector<Variable*> const &vs);
 	~Blocks(void);
 	void mergeLeft(Block *r);
@@ -65,13 +92,35 @@ public:
 	std::list<Variable*> *totalOrder();
 	void cleanup();
 	double cost();
+	/**
+	 * Blocks are allocated from an arena owned by this structure: chunks
+	 * of storage that are recycled as blocks are merged and split, and
+	 * released together when the structure is destroyed.
+	 */
+	Block *createBlock(Variable* const v=NULL);
+	void destroyBlock(Block *b);
+	// Adds b, if it is not already present.
+	void insert(Block *b);
+	void erase(Block *b);
+	const_iterator begin() const { return const_iterator(store,0); }
+	const_iterator end() const { return const_iterator(store,store.size()); }
+	size_t size() const { return count; }
     
-    long blockTimeCtr;
+	long blockTimeCtr;
 private:
 	void dfsVisit(Variable *v, std::list<Variable*> *order);
 	void removeBlock(Block *doomed);
 	std::vector<Variable*> const &vs;
 	int nvs;
+	// Blocks by index, NULL in slots listed in freeSlots.
+	std::vector<Block*> store;
+	std::vector<size_t> freeSlots;
+	size_t count;
+	std::vector<char*> arenaChunks;
+	size_t arenaChunkUsed;
+	std::vector<void*> arenaFree;
+	// Storage taken from the constraint heaps of destroyed blocks.
+	std::vector<std::vector<Constraint*> > heapBuffers;
 };
 
 }
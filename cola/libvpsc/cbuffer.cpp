@@ -30,75 +30,80 @@
  *   Tim Dwyer <tgdwyer@gmail.com>
  */
 #include <cfloat>
+#include <algorithm>
 
 #include "libvpsc/cbuffer.h"
+#include "libvpsc/block.h"
 #include "libvpsc/constraint.h"
+#include "libvpsc/variable.h"
 #include "libvpsc/assertions.h"
 
 namespace vpsc {
-    static const double ZERO_UPPERBOUND=-0.0000001;
+    static const double ZERO_UPPERBOUND=-1e-10;
+    static inline bool violated(Constraint const* c, const double slack) {
+        return c->equality||slack<ZERO_UPPERBOUND;
+    }
+    void CBuffer::enqueue(Constraint* c, const double slack) {
+        Entry e;
+        // Equality constraints are always merged, so they go first.
+        e.slack=c->equality?-DBL_MAX:slack;
+        e.order=counter++;
+        e.c=c;
+        heap.push_back(e);
+        std::push_heap(heap.begin(),heap.end());
+    }
+    /**
+     * Queues c if it is inactive and violated, or an inactive equality.
+     */
+    void CBuffer::push(Constraint* c) {
+        if(c->active||c->unsatisfiable) return;
+        double slack=c->slack();
+        if(violated(c,slack)) enqueue(c,slack);
+    }
     void CBuffer::load() {
-        size=0; 
-        double buffMaxSlack=-DBL_MAX;
-        unsigned buffMaxSlackPos=0;
-        for(Constraints::iterator i=master_list.begin();
-                i!=master_list.end();++i) {
-            Constraint *c=*i;
-            double slack = c->slack();
-            if(c->equality||slack<ZERO_UPPERBOUND) {
-                if(size<maxsize) {
-                    // make sure buffer is full
-                    buffer[size]=c;
-                    if(slack>buffMaxSlack) {
-                        buffMaxSlack=slack;
-                        buffMaxSlackPos=size;
-                    }
-                    size++;
-                } else {
-                    // if c is more violated than the least violated
-                    // constraint in the buffer then replace it
-                    buffer[buffMaxSlackPos]=c;
-                    // need to search the buffer for the new least
-                    // violated constraint
-                    buffMaxSlack=-DBL_MAX;
-                    for(unsigned i=0;i<size;i++) {
-                        c=buffer[i];
-                        if(!c->equality&&buffMaxSlack < c->slack()) {
-                            buffMaxSlack = slack;
-                            buffMaxSlackPos = i;
-                        }
-                    }
-                }
+        for(unsigned i=0;i<cs.size();i++) {
+            push(cs[i]);
+        }
+    }
+    void CBuffer::moved(Block* b) {
+        for(std::vector<Variable*>::iterator v=b->vars->begin();
+                v!=b->vars->end();++v) {
+            for(Constraints::iterator i=(*v)->out.begin();
+                    i!=(*v)->out.end();++i) {
+                push(*i);
+            }
+            for(Constraints::iterator i=(*v)->in.begin();
+                    i!=(*v)->in.end();++i) {
+                push(*i);
             }
         }
     }
+    /**
+     * Removes and returns the most violated constraint (or an equality
+     * constraint), or NULL if none is violated.  A constraint may have
+     * been queued more than once; the extra entries are skipped or
+     * re-evaluated when they reach the top.
+     */
     Constraint* CBuffer::mostViolated() {
-        Constraint* v=NULL;
         while(true) {
-            if(size==0) {
+            if(heap.empty()) {
                 load();
-                if(size==0) break;
-            }
-            double minSlack=DBL_MAX;
-            int i,deletePos=-1;
-            for(i=0;i<(int)size;i++) {
-                Constraint *c=buffer[i];
-                double slack = c->slack();
-                if(!(c->equality||slack < ZERO_UPPERBOUND)) {
-                    COLA_ASSERT(size>0);
-                    buffer[i--]=buffer[--size];
-                } else if(c->equality||slack < minSlack) {
-                    v=c;
-                    deletePos=i;    
-                    minSlack=slack;
-                }
+                if(heap.empty()) return NULL;
             }
-            if(deletePos>=0) {
-                COLA_ASSERT(size>0);
-                buffer[deletePos]=buffer[--size];
-                break;
+            std::pop_heap(heap.begin(),heap.end());
+            Entry top=heap.back();
+            heap.pop_back();
+            Constraint *c=top.c;
+            if(c->active||c->unsatisfiable) continue;
+            if(c->equality) return c;
+            double slack=c->slack();
+            if(!violated(c,slack)) continue;
+            if(slack>top.slack && !heap.empty() && slack>heap.front().slack) {
+                // Stale key, and now less violated than the next one.
+                enqueue(c,slack);
+                continue;
             }
+            return c;
         }
-        return v;
     }
 }
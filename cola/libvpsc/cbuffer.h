@@ -25,31 +25,59 @@
 
 /**
  * @file libvpsc/cbuffer.h
- * @brief 
+ * @brief A queue of violated constraints used by IncSolver::satisfy().
  *
  * Authors:
  *   Tim Dwyer <tgdwyer@gmail.com>
  *
  */
+#ifndef SEEN_LIBVPSC_CBUFFER_H
+#define SEEN_LIBVPSC_CBUFFER_H
+
 #include <vector>
 
 namespace vpsc {
+    class Block;
     class Constraint;
+    /**
+     * A heap of the violated inactive constraints, keyed on slack, from
+     * which IncSolver::satisfy() takes the most violated constraint.
+     *
+     * Keys go stale as blocks move.  moved() should be called for the
+     * variables whose positions changed the most (the absorbed block of a
+     * merge, both halves of a split) to queue their constraints with fresh
+     * keys.  Everything else is checked lazily: the top of the heap is
+     * re-evaluated before it is returned, and when the heap runs dry all
+     * constraints are checked once more, so NULL is only returned if no
+     * inactive constraint is violated.
+     */
     class CBuffer {
     public:
-        CBuffer(std::vector<Constraint*>& l,
-                const unsigned maxsize=5) 
-                 : master_list(l), maxsize(maxsize), size(0) {
-            buffer.resize(maxsize);
+        CBuffer(std::vector<Constraint*> const& cs) 
+                 : cs(cs), counter(0) {
             load();
         }
-        void reset() { size=0; }
-        void load();
+        void moved(Block* b);
         Constraint* mostViolated();
     private:
-        std::vector<Constraint*>& master_list;
-        std::vector<Constraint*> buffer;
-        const unsigned maxsize;
-        unsigned size;
+        struct Entry {
+            double slack;
+            unsigned long order;
+            Constraint *c;
+            // The heap puts the greatest first, we want the most violated
+            // (then the earliest queued) first.
+            bool operator<(const Entry& rhs) const {
+                if(slack!=rhs.slack) return slack>rhs.slack;
+                return order>rhs.order;
+            }
+        };
+        void load();
+        void push(Constraint* c);
+        void enqueue(Constraint* c, const double slack);
+        std::vector<Constraint*> const& cs;
+        std::vector<Entry> heap;
+        unsigned long counter;
     };
 }
+
+#endif // SEEN_LIBVPSC_CBUFFER_H
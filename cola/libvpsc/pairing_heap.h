@@ -94,7 +94,7 @@ class PairingHeap
 #endif
 public:
 	PairingHeap() : root(NULL), counter(0) { }
-	PairingHeap(const PairingHeap & rhs) { 
+	PairingHeap(const PairingHeap & rhs) : root(NULL), counter(0) { 
 		// uses operator= to make deep copy
 		*this = rhs; 
 	}
@@ -130,6 +130,9 @@ protected:
 private:
 	PairNode<T> *root;
 	unsigned counter;
+	// Scratch space for combineSiblings, kept per heap (rather than in a
+	// static) so that heaps can be used from several threads at once.
+	mutable std::vector<PairNode<T> *> treeArray;
 	void reclaimMemory( PairNode<T> *t ) const;
 	void compareAndLink( PairNode<T> * & first, PairNode<T> *second ) const;
 	PairNode<T> * combineSiblings( PairNode<T> *firstSibling ) const;
@@ -316,7 +319,8 @@ PairingHeap<T,TCompare>::combineSiblings( PairNode<T> *firstSibling ) const
 		return firstSibling;
 
 	// Allocate the array
-	static std::vector<PairNode<T> *> treeArray( 5 );
+	if( treeArray.empty( ) )
+		treeArray.resize( 5 );
 
 	// Store the subtrees in an array
 	int numSiblings = 0;
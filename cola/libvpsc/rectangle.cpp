@@ -33,6 +33,7 @@
  */
 
 #include <set>
+#include <new>
 #include <cstdlib>
 #include <algorithm>
 #include <cstdio>
@@ -115,49 +116,170 @@ void Rectangle::reset(unsigned d, double x, double X) {
     }
 }
 
+namespace {
+/*
+ * Fixed-size blocks of memory kept on a free list.  The blocks given back
+ * are handed out again by later allocations, and all the memory is
+ * released with the pool.  The block size is set by the first allocation.
+ */
+class FreeListPool {
+public:
+    FreeListPool() : blockSize(0), freeList(NULL) {}
+    ~FreeListPool() {
+        for(size_t i=0;i<chunks.size();++i) {
+            delete [] chunks[i];
+        }
+    }
+    // Whether the pool holds blocks of the given size.
+    bool holds(const size_t size) const {
+        return blockSize==0 || blockSize==roundUp(size);
+    }
+    // Returns NULL if the pool holds blocks of another size.
+    void *allocate(const size_t size) {
+        if(!holds(size)) {
+            return NULL;
+        }
+        blockSize=roundUp(size);
+        if(freeList==NULL) {
+            char *chunk=new char[blocksPerChunk*blockSize];
+            chunks.push_back(chunk);
+            for(size_t i=0;i<blocksPerChunk;++i) {
+                deallocate(chunk+i*blockSize);
+            }
+        }
+        void *block=freeList;
+        freeList=*static_cast<void**>(block);
+        return block;
+    }
+    void deallocate(void *block) {
+        *static_cast<void**>(block)=freeList;
+        freeList=block;
+    }
+private:
+    FreeListPool(const FreeListPool&);
+    FreeListPool& operator=(const FreeListPool&);
+    static size_t roundUp(const size_t size) {
+        const size_t align=sizeof(double)>sizeof(void*)
+            ?sizeof(double):sizeof(void*);
+        return (size+align-1)/align*align;
+    }
+    static const size_t blocksPerChunk=64;
+    size_t blockSize;
+    void *freeList;
+    vector<char*> chunks;
+};
+
+/*
+ * Allocates the elements of a std::set one at a time from a FreeListPool,
+ * so that a scanline reuses the pool's memory rather than allocating each
+ * time a rectangle is inserted.
+ */
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+    template <typename U> struct rebind { typedef PoolAllocator<U> other; };
+
+    explicit PoolAllocator(FreeListPool *pool) : pool(pool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+    pointer allocate(const size_type n, const void* =NULL) {
+        void *p=n==1?pool->allocate(sizeof(T)):NULL;
+        if(p==NULL) {
+            p=::operator new(n*sizeof(T));
+        }
+        return static_cast<pointer>(p);
+    }
+    void deallocate(pointer p, const size_type n) {
+        if(n==1 && pool->holds(sizeof(T))) {
+            pool->deallocate(p);
+        } else {
+            ::operator delete(p);
+        }
+    }
+    size_type max_size() const { return size_type(-1)/sizeof(T); }
+    void construct(pointer p, const T& value) { new(p) T(value); }
+    void destroy(pointer p) { p->~T(); }
+
+    FreeListPool *pool;
+};
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {
+    return a.pool==b.pool;
+}
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {
+    return a.pool!=b.pool;
+}
+}
+
 struct Node;
 struct CmpNodePos { bool operator()(const Node* u, const Node* v) const; };
 
-typedef set<Node*,CmpNodePos> NodeSet;
+typedef set<Node*,CmpNodePos,PoolAllocator<Node*> > NodeSet;
+// Neighbour lists are kept sorted by CmpNodePos.
+typedef vector<Node*> NodeList;
 
+// The extents of the rectangle are copied into the node, with the borders
+// for this call added, so the scan need not read Rectangle::xBorder/yBorder.
 struct Node {
     Variable *v;
-    Rectangle *r;
+    double minX, maxX, minY, maxY;
     double pos;
     Node *firstAbove, *firstBelow;
-    NodeSet *leftNeighbours, *rightNeighbours;
-    Node(Variable *v, Rectangle *r, double p) 
-        : v(v),r(r),pos(p),
-          firstAbove(NULL), firstBelow(NULL),
-          leftNeighbours(NULL), rightNeighbours(NULL)
+    NodeList leftNeighbours, rightNeighbours;
+    Node(Variable *v, Rectangle *r, const unsigned d,
+            const double xBorder, const double yBorder) 
+        : v(v),
+          minX(r->getMinD(0,xBorder)), maxX(r->getMaxD(0,xBorder)),
+          minY(r->getMinD(1,yBorder)), maxY(r->getMaxD(1,yBorder)),
+          pos(d==0?getCentreX():getCentreY()),
+          firstAbove(NULL), firstBelow(NULL)
      
     {
-        COLA_ASSERT(r->width()<1e40);
-    }
-    ~Node() {
-        delete leftNeighbours;
-        delete rightNeighbours;
+        COLA_ASSERT(width()<1e40);
     }
-    void addLeftNeighbour(Node *u) {
-        COLA_ASSERT(leftNeighbours!=NULL);
-        leftNeighbours->insert(u);
+    double width() const { return maxX-minX; }
+    double height() const { return maxY-minY; }
+    double getCentreX() const { return minX+width()/2.0; }
+    double getCentreY() const { return minY+height()/2.0; }
+    // As Rectangle::overlapX and overlapY.
+    double overlapX(Node *u) const {
+        double ux=getCentreX(), vx=u->getCentreX();
+        if (ux <= vx && u->minX < maxX)
+            return maxX - u->minX;
+        if (vx <= ux && minX < u->maxX)
+            return u->maxX - minX;
+        return 0;
     }
-    void addRightNeighbour(Node *u) {
-        COLA_ASSERT(rightNeighbours!=NULL);
-        rightNeighbours->insert(u);
+    double overlapY(Node *u) const {
+        double uy=getCentreY(), vy=u->getCentreY();
+        if (uy <= vy && u->minY < maxY)
+            return maxY - u->minY;
+        if (vy <= uy && minY < u->maxY)
+            return u->maxY - minY;
+        return 0;
     }
-    void setNeighbours(NodeSet *left, NodeSet *right) {
-        leftNeighbours=left;
-        rightNeighbours=right;
-        for(NodeSet::iterator i=left->begin();i!=left->end();++i) {
-            Node *v=*(i);
-            v->addRightNeighbour(this);
+    void setNeighbours() {
+        for(NodeList::iterator i=leftNeighbours.begin();
+                i!=leftNeighbours.end();++i) {
+            addNeighbour((*i)->rightNeighbours,this);
         }
-        for(NodeSet::iterator i=right->begin();i!=right->end();++i) {
-            Node *v=*(i);
-            v->addLeftNeighbour(this);
+        for(NodeList::iterator i=rightNeighbours.begin();
+                i!=rightNeighbours.end();++i) {
+            addNeighbour((*i)->leftNeighbours,this);
         }
     }
+    static void addNeighbour(NodeList &ns, Node *u);
+    static void removeNeighbour(NodeList &ns, Node *u);
 };
 bool CmpNodePos::operator() (const Node* u, const Node* v) const {
     COLA_ASSERT(!isNaN(u->pos));
@@ -170,36 +292,47 @@ bool CmpNodePos::operator() (const Node* u, const Node* v) const {
     }
     return u < v;
 }
+void Node::addNeighbour(NodeList &ns, Node *u) {
+    ns.insert(std::lower_bound(ns.begin(),ns.end(),u,CmpNodePos()),u);
+}
+void Node::removeNeighbour(NodeList &ns, Node *u) {
+    NodeList::iterator i=std::lower_bound(ns.begin(),ns.end(),u,CmpNodePos());
+    COLA_ASSERT(i!=ns.end() && *i==u);
+    ns.erase(i);
+}
 
-NodeSet* getLeftNeighbours(NodeSet &scanline,Node *v) {
-    NodeSet *leftv = new NodeSet;
+// Fills v->leftNeighbours, in order, from the nodes to the left of v in
+// the scanline.
+void getLeftNeighbours(NodeSet &scanline,Node *v) {
+    NodeList &leftv=v->leftNeighbours;
     NodeSet::iterator i=scanline.find(v);
     while(i!=scanline.begin()) {
         Node *u=*(--i);
-        if(u->r->overlapX(v->r)<=0) {
-            leftv->insert(u);
-            return leftv;
+        if(u->overlapX(v)<=0) {
+            leftv.push_back(u);
+            break;
         }
-        if(u->r->overlapX(v->r)<=u->r->overlapY(v->r)) {
-            leftv->insert(u);
+        if(u->overlapX(v)<=u->overlapY(v)) {
+            leftv.push_back(u);
         }
     }
-    return leftv;
+    std::reverse(leftv.begin(),leftv.end());
 }
-NodeSet* getRightNeighbours(NodeSet &scanline,Node *v) {
-    NodeSet *rightv = new NodeSet;
+// Fills v->rightNeighbours, in order, from the nodes to the right of v in
+// the scanline.
+void getRightNeighbours(NodeSet &scanline,Node *v) {
+    NodeList &rightv=v->rightNeighbours;
     NodeSet::iterator i=scanline.find(v);
     for(++i;i!=scanline.end(); ++i) {
         Node *u=*(i);
-        if(u->r->overlapX(v->r)<=0) {
-            rightv->insert(u);
-            return rightv;
+        if(u->overlapX(v)<=0) {
+            rightv.push_back(u);
+            return;
         }
-        if(u->r->overlapX(v->r)<=u->r->overlapY(v->r)) {
-            rightv->insert(u);
+        if(u->overlapX(v)<=u->overlapY(v)) {
+            rightv.push_back(u);
         }
     }
-    return rightv;
 }
 
 typedef enum {Open, Close} EventType;
@@ -209,7 +342,6 @@ struct Event {
     double pos;
     Event(EventType t, Node *v, double p) : type(t),v(v),pos(p) {};
 };
-Event **events;
 int compare_events(const void *a, const void *b) {
     Event *ea=*(Event**)a;
     Event *eb=*(Event**)b;
@@ -231,35 +363,79 @@ int compare_events(const void *a, const void *b) {
     return 0;
 }
 
+namespace {
+/*
+ * Scratch memory for generating constraints, kept from one call to the
+ * next.  If constraintPool is set, the constraints are allocated from it
+ * and have to be released by its owner rather than deleted.
+ */
+struct ConstraintGenerationScratch {
+    vector<Node> nodes;
+    vector<Event> eventStore;
+    vector<Event*> events;
+    FreeListPool scanlinePool;
+    FreeListPool *constraintPool;
+    ConstraintGenerationScratch() : constraintPool(NULL) {}
+    // Empties the containers, ready for n rectangles.
+    void reset(const unsigned n) {
+        nodes.clear();
+        nodes.reserve(n);
+        eventStore.clear();
+        eventStore.reserve(2*n);
+        events.clear();
+    }
+    Constraint *newConstraint(Variable *left, Variable *right,
+            const double gap) {
+        if(constraintPool==NULL) {
+            return new Constraint(left,right,gap);
+        }
+        return new (constraintPool->allocate(sizeof(Constraint)))
+            Constraint(left,right,gap);
+    }
+};
+}
+
 /**
  * Prepares constraints in order to apply VPSC horizontally.  Assumes variables have already been created.
  * useNeighbourLists determines whether or not a heuristic is used to deciding whether to resolve
  * all overlap in the x pass, or leave some overlaps for the y pass.
  */
-void generateXConstraints(vector<Rectangle*> const & rs, vector<Variable*> const &vars, vector<Constraint*> &cs, const bool useNeighbourLists) {
+static void generateXConstraints(vector<Rectangle*> const & rs, vector<Variable*> const &vars, vector<Constraint*> &cs, const bool useNeighbourLists,
+        const double xBorder, const double yBorder,
+        ConstraintGenerationScratch &scratch) {
     const unsigned n = rs.size();
     COLA_ASSERT(vars.size()>=n);
-    events=new Event*[2*n];
-    unsigned i,ctr=0;
+    // The nodes and events are held in arrays rather than allocated one
+    // at a time; this also makes ties in CmpNodePos follow rectangle order.
+    scratch.reset(n);
+    vector<Node> &nodes=scratch.nodes;
+    vector<Event> &eventStore=scratch.eventStore;
+    vector<Event*> &events=scratch.events;
+    unsigned i;
     for(i=0;i<n;i++) {
-        vars[i]->desiredPosition=rs[i]->getCentreX();
-        Node *v = new Node(vars[i],rs[i],rs[i]->getCentreX());
-        events[ctr++]=new Event(Open,v,rs[i]->getMinY());
-        events[ctr++]=new Event(Close,v,rs[i]->getMaxY());
+        nodes.push_back(Node(vars[i],rs[i],0,xBorder,yBorder));
+        Node *v = &nodes.back();
+        vars[i]->desiredPosition=v->pos;
+        eventStore.push_back(Event(Open,v,v->minY));
+        events.push_back(&eventStore.back());
+        eventStore.push_back(Event(Close,v,v->maxY));
+        events.push_back(&eventStore.back());
+    }
+    if(n>0) {
+        qsort(&events[0], (size_t)2*n, sizeof(Event*), compare_events );
     }
-    qsort((Event*)events, (size_t)2*n, sizeof(Event*), compare_events );
 
-    NodeSet scanline;
+    NodeSet scanline(CmpNodePos(),
+            PoolAllocator<Node*>(&scratch.scanlinePool));
     for(i=0;i<2*n;i++) {
         Event *e=events[i];
         Node *v=e->v;
         if(e->type==Open) {
             scanline.insert(v);
             if(useNeighbourLists) {
-                v->setNeighbours(
-                    getLeftNeighbours(scanline,v),
-                    getRightNeighbours(scanline,v)
-                );
+                getLeftNeighbours(scanline,v);
+                getRightNeighbours(scanline,v);
+                v->setNeighbours();
             } else {
                 NodeSet::iterator it=scanline.find(v);
                 if(it!=scanline.begin()) {
@@ -278,70 +454,82 @@ void generateXConstraints(vector<Rectangle*> const & rs, vector<Variable*> const
             size_t result;
             // Close event
             if(useNeighbourLists) {
-                for(NodeSet::iterator i=v->leftNeighbours->begin();
-                    i!=v->leftNeighbours->end();i++
+                for(NodeList::iterator i=v->leftNeighbours.begin();
+                    i!=v->leftNeighbours.end();i++
                 ) {
                     Node *u=*i;
-                    double sep = (v->r->width()+u->r->width())/2.0;
-                    cs.push_back(new Constraint(u->v,v->v,sep));
-                    result=u->rightNeighbours->erase(v);
-                    COLA_ASSERT(result==1);
+                    double sep = (v->width()+u->width())/2.0;
+                    cs.push_back(scratch.newConstraint(u->v,v->v,sep));
+                    Node::removeNeighbour(u->rightNeighbours,v);
                 }
                 
-                for(NodeSet::iterator i=v->rightNeighbours->begin();
-                    i!=v->rightNeighbours->end();i++
+                for(NodeList::iterator i=v->rightNeighbours.begin();
+                    i!=v->rightNeighbours.end();i++
                 ) {
                     Node *u=*i;
-                    double sep = (v->r->width()+u->r->width())/2.0;
-                    cs.push_back(new Constraint(v->v,u->v,sep));
-                    result=u->leftNeighbours->erase(v);
-                    COLA_ASSERT(result==1);
+                    double sep = (v->width()+u->width())/2.0;
+                    cs.push_back(scratch.newConstraint(v->v,u->v,sep));
+                    Node::removeNeighbour(u->leftNeighbours,v);
                 }
+                NodeList().swap(v->leftNeighbours);
+                NodeList().swap(v->rightNeighbours);
             } else {
                 Node *l=v->firstAbove, *r=v->firstBelow;
                 if(l!=NULL) {
-                    double sep = (v->r->width()+l->r->width())/2.0;
-                    cs.push_back(new Constraint(l->v,v->v,sep));
+                    double sep = (v->width()+l->width())/2.0;
+                    cs.push_back(scratch.newConstraint(l->v,v->v,sep));
                     l->firstBelow=v->firstBelow;
                 }
                 if(r!=NULL) {
-                    double sep = (v->r->width()+r->r->width())/2.0;
-                    cs.push_back(new Constraint(v->v,r->v,sep));
+                    double sep = (v->width()+r->width())/2.0;
+                    cs.push_back(scratch.newConstraint(v->v,r->v,sep));
                     r->firstAbove=v->firstAbove;
                 }
             }
             result=scanline.erase(v);
             COLA_ASSERT(result==1);
-            delete v;
         }
-        delete e;
     }
     COLA_ASSERT(scanline.size()==0);
-    delete [] events;
+}
+void generateXConstraints(vector<Rectangle*> const & rs, vector<Variable*> const &vars, vector<Constraint*> &cs, const bool useNeighbourLists,
+        const double xBorder, const double yBorder) {
+    ConstraintGenerationScratch scratch;
+    generateXConstraints(rs,vars,cs,useNeighbourLists,xBorder,yBorder,scratch);
 }
 
 /**
  * Prepares constraints in order to apply VPSC vertically to remove ALL overlap.
  */
-void generateYConstraints(const Rectangles& rs, const Variables& vars, Constraints& cs) {
+static void generateYConstraints(const Rectangles& rs, const Variables& vars, Constraints& cs,
+        const double xBorder, const double yBorder,
+        ConstraintGenerationScratch &scratch) {
     const unsigned n = rs.size();
     COLA_ASSERT(vars.size()>=n);
-    events=new Event*[2*n];
-    unsigned ctr=0;
+    scratch.reset(n);
+    vector<Node> &nodes=scratch.nodes;
+    vector<Event> &eventStore=scratch.eventStore;
+    vector<Event*> &events=scratch.events;
     Rectangles::const_iterator ri=rs.begin(), re=rs.end();
     Variables::const_iterator vi=vars.begin(), ve=vars.end();
     for(;ri!=re&&vi!=ve;++ri,++vi) {
         Rectangle* r=*ri;
         Variable* v=*vi;
-        v->desiredPosition=r->getCentreY();
-        Node *node = new Node(v,r,r->getCentreY());
-        COLA_ASSERT(r->getMinX()<r->getMaxX());
-        events[ctr++]=new Event(Open,node,r->getMinX());
-        events[ctr++]=new Event(Close,node,r->getMaxX());
+        nodes.push_back(Node(v,r,1,xBorder,yBorder));
+        Node *node = &nodes.back();
+        v->desiredPosition=node->pos;
+        COLA_ASSERT(node->minX<node->maxX);
+        eventStore.push_back(Event(Open,node,node->minX));
+        events.push_back(&eventStore.back());
+        eventStore.push_back(Event(Close,node,node->maxX));
+        events.push_back(&eventStore.back());
     }
     COLA_ASSERT(ri==rs.end());
-    qsort((Event*)events, (size_t)2*n, sizeof(Event*), compare_events );
-    NodeSet scanline;
+    if(n>0) {
+        qsort(&events[0], (size_t)2*n, sizeof(Event*), compare_events );
+    }
+    NodeSet scanline(CmpNodePos(),
+            PoolAllocator<Node*>(&scratch.scanlinePool));
 #ifndef NDEBUG
     size_t deletes=0;
 #endif
@@ -366,13 +554,13 @@ void generateYConstraints(const Rectangles& rs, const Variables& vars, Constrain
             // Close event
             Node *l=v->firstAbove, *r=v->firstBelow;
             if(l!=NULL) {
-                double sep = (v->r->height()+l->r->height())/2.0;
-                cs.push_back(new Constraint(l->v,v->v,sep));
+                double sep = (v->height()+l->height())/2.0;
+                cs.push_back(scratch.newConstraint(l->v,v->v,sep));
                 l->firstBelow=v->firstBelow;
             }
             if(r!=NULL) {
-                double sep = (v->r->height()+r->r->height())/2.0;
-                cs.push_back(new Constraint(v->v,r->v,sep));
+                double sep = (v->height()+r->height())/2.0;
+                cs.push_back(scratch.newConstraint(v->v,r->v,sep));
                 r->firstAbove=v->firstAbove;
             }
 #ifndef NDEBUG
@@ -381,13 +569,15 @@ void generateYConstraints(const Rectangles& rs, const Variables& vars, Constrain
 #endif
             scanline.erase(v);
             COLA_ASSERT(erased==1);
-            delete v;
         }
-        delete e;
     }
     COLA_ASSERT(scanline.size()==0);
     COLA_ASSERT(deletes==n);
-    delete [] events;
+}
+void generateYConstraints(const Rectangles& rs, const Variables& vars, Constraints& cs,
+        const double xBorder, const double yBorder) {
+    ConstraintGenerationScratch scratch;
+    generateYConstraints(rs,vars,cs,xBorder,yBorder,scratch);
 }
 #include "libvpsc/linesegment.h"
 using namespace linesegment;
@@ -565,6 +755,60 @@ void removeoverlaps(Rectangles& rs) {
     removeoverlaps(rs,fixed);
 }
 #define ISNOTNAN(d) (d)==(d)
+namespace {
+/*
+ * Scratch memory for removing overlaps.  The variables, constraints,
+ * scanline and other containers are kept from one call to the next, so
+ * that a batch of rectangle sets can be processed without reallocating
+ * them for every set.
+ */
+struct OverlapRemovalWorkspace {
+    Variables vs;
+    // Allocated from constraintPool, see releaseConstraints().
+    Constraints cs;
+    vector<double> initX;
+    // Storage for the rectangles of the current set in a batch.
+    vector<Rectangle> rects;
+    Rectangles rs;
+    ConstraintGenerationScratch generation;
+    OverlapRemovalWorkspace() {
+        generation.constraintPool=&constraintPool;
+    }
+    ~OverlapRemovalWorkspace() {
+        releaseConstraints();
+        for_each(pool.begin(),pool.end(),delete_object());
+    }
+    // Destroys the constraints in cs, returning them to the pool.
+    void releaseConstraints() {
+        for(Constraints::iterator c=cs.begin();c!=cs.end();++c) {
+            (*c)->~Constraint();
+            constraintPool.deallocate(*c);
+        }
+        cs.clear();
+    }
+    // Makes vs hold n variables in their initial state.
+    void resetVariables(const unsigned n) {
+        while(pool.size()<n) {
+            pool.push_back(new Variable(pool.size()));
+        }
+        vs.assign(pool.begin(),pool.begin()+n);
+        for(unsigned i=0;i<n;++i) {
+            Variable *v=vs[i];
+            v->id=i;
+            v->desiredPosition=v->finalPosition=0;
+            v->weight=1;
+            v->scale=1;
+            v->offset=0;
+            v->block=NULL;
+            v->visited=false;
+            v->fixedDesiredPosition=false;
+        }
+    }
+private:
+    Variables pool;
+    FreeListPool constraintPool;
+};
+}
 /** 
  * Moves rectangles to remove all overlaps.  A heuristic
  * attempts to move by as little as possible.  The heuristic is
@@ -578,56 +822,55 @@ void removeoverlaps(Rectangles& rs) {
  * @param rs the rectangles which will be moved to remove overlap
  * @param fixed a set of indices to rectangles which should not be moved
  * @param thirdPass optionally run the third horizontal pass described above.
+ * @param ws scratch memory
  */
-void removeoverlaps(Rectangles& rs, const set<unsigned>& fixed, bool thirdPass) {
-    const double xBorder=Rectangle::xBorder, yBorder=Rectangle::yBorder;
+static void removeoverlaps(Rectangles& rs, const set<unsigned>& fixed,
+        bool thirdPass, const double xBorder, const double yBorder,
+        OverlapRemovalWorkspace& ws) {
     static const double EXTRA_GAP=1e-3;
-    static const size_t ARRAY_UNUSED=1;
     unsigned n=rs.size();
+    Variables& vs=ws.vs;
+    Constraints& cs=ws.cs;
     try {
         // The extra gap avoids numerical imprecision problems
-        Rectangle::setXBorder(xBorder+EXTRA_GAP);
-        Rectangle::setYBorder(yBorder+EXTRA_GAP);
-        Variables vs(n);
+        ws.resetVariables(n);
         Variables::iterator v;
         unsigned i=0;
-        vector<double> initX(thirdPass?n:ARRAY_UNUSED);
+        if(thirdPass) {
+            ws.initX.resize(n);
+        }
         for(v=vs.begin();v!=vs.end();++v,++i) {
-            double weight=1;
             if(fixed.find(i)!=fixed.end()) {
-                weight=10000;
+                (*v)->weight=10000;
             }
-            *v=new Variable(i,0,weight);
             if(thirdPass) {
-                initX[i]=rs[i]->getCentreX();
+                ws.initX[i]=rs[i]->getCentreX();
             }
         }
-        Constraints cs;
-        generateXConstraints(rs,vs,cs,true);
+        COLA_ASSERT(cs.empty());
+        generateXConstraints(rs,vs,cs,true,
+                xBorder+EXTRA_GAP,yBorder+EXTRA_GAP,ws.generation);
         Solver vpsc_x(vs,cs);
         vpsc_x.solve();
         Rectangles::iterator r=rs.begin();
         for(v=vs.begin();v!=vs.end();++v,++r) {
             COLA_ASSERT(ISNOTNAN((*v)->finalPosition));
-            (*r)->moveCentreX((*v)->finalPosition);
+            (*r)->moveCentreD(0,(*v)->finalPosition);
         }
         COLA_ASSERT(r==rs.end());
-        for_each(cs.begin(),cs.end(),delete_object());
-        cs.clear();
+        ws.releaseConstraints();
         // Removing the extra gap here ensures things that were moved to be
         // adjacent to one another above are not considered overlapping
-        Rectangle::setXBorder(xBorder);
-        generateYConstraints(rs,vs,cs);
+        generateYConstraints(rs,vs,cs,xBorder,yBorder+EXTRA_GAP,
+                ws.generation);
         Solver vpsc_y(vs,cs);
         vpsc_y.solve();
         r=rs.begin();
         for(v=vs.begin();v!=vs.end();++v,++r) {
             COLA_ASSERT(ISNOTNAN((*v)->finalPosition));
-            (*r)->moveCentreY((*v)->finalPosition);
+            (*r)->moveCentreD(1,(*v)->finalPosition);
         }
-        for_each(cs.begin(),cs.end(),delete_object());
-        cs.clear();
-        Rectangle::setYBorder(yBorder);
+        ws.releaseConstraints();
         if(thirdPass) {
             // we reset x positions to their original values
             // and apply a third pass horizontally so that
@@ -635,34 +878,91 @@ void removeoverlaps(Rectangles& rs, const set<unsigned>& fixed, bool thirdPass)
             // first horizontal pass (i.e. their overlap
             // was later resolved vertically) have an
             // opportunity now to stay put.
-            Rectangle::setXBorder(xBorder+EXTRA_GAP);
             r=rs.begin();
             for(v=vs.begin();v!=vs.end();++v,++r) {
-                (*r)->moveCentreX(initX[(*v)->id]);
+                (*r)->moveCentreD(0,ws.initX[(*v)->id]);
             }
-            generateXConstraints(rs,vs,cs,false);
+            generateXConstraints(rs,vs,cs,false,xBorder+EXTRA_GAP,yBorder,
+                    ws.generation);
             Solver vpsc_x2(vs,cs);
             vpsc_x2.solve();
             r=rs.begin();
             for(v=vs.begin();v!=vs.end();++v,++r) {
                 COLA_ASSERT(ISNOTNAN((*v)->finalPosition));
-                (*r)->moveCentreX((*v)->finalPosition);
+                (*r)->moveCentreD(0,(*v)->finalPosition);
             }
         }
-        Rectangle::setXBorder(xBorder);
-        for_each(cs.begin(),cs.end(),delete_object());
-        for_each(vs.begin(),vs.end(),delete_object());
+        ws.releaseConstraints();
     } catch (char *str) {
+        ws.releaseConstraints();
         std::cerr<<str<<std::endl;
         for(Rectangles::iterator r=rs.begin();r!=rs.end();++r) {
             std::cerr << **r <<std::endl;
         }
     }
-    COLA_ASSERT(noRectangleOverlaps(rs));
+    COLA_ASSERT(noRectangleOverlaps(rs,xBorder,yBorder));
+}
+void removeoverlaps(Rectangles& rs, const set<unsigned>& fixed, bool thirdPass,
+        const double xBorder, const double yBorder) {
+    OverlapRemovalWorkspace ws;
+    removeoverlaps(rs,fixed,thirdPass,xBorder,yBorder,ws);
+}
+void removeoverlaps(const unsigned numSets, const unsigned *setStarts,
+        double *centreX, double *centreY,
+        const double *width, const double *height,
+        bool thirdPass, bool concurrently,
+        const double xBorder, const double yBorder) {
+    const int num=(int)numSets;
+    const set<unsigned> fixed;
+#ifdef _OPENMP
+    #pragma omp parallel if(concurrently)
+#endif
+    {
+        // Each thread reuses its own scratch memory for all of its sets.
+        OverlapRemovalWorkspace ws;
+#ifdef _OPENMP
+        #pragma omp for schedule(dynamic)
+#endif
+        for(int s=0;s<num;++s) {
+            const unsigned start=setStarts[s], n=setStarts[s+1]-start;
+            ws.rects.resize(n);
+            ws.rs.resize(n);
+            for(unsigned i=0;i<n;++i) {
+                const unsigned k=start+i;
+                Rectangle& r=ws.rects[i];
+                r.reset(0,centreX[k]-width[k]/2.0,centreX[k]+width[k]/2.0);
+                r.reset(1,centreY[k]-height[k]/2.0,centreY[k]+height[k]/2.0);
+                ws.rs[i]=&r;
+            }
+            removeoverlaps(ws.rs,fixed,thirdPass,xBorder,yBorder,ws);
+            for(unsigned i=0;i<n;++i) {
+                const Rectangle& r=ws.rects[i];
+                centreX[start+i]=r.getCentreX();
+                centreY[start+i]=r.getCentreY();
+            }
+        }
+    }
+#ifndef _OPENMP
+    (void)concurrently;
+#endif
 }
 
-
+// As Rectangle::overlapD, but with the given border.
+static double overlapD(const Rectangle *u, const Rectangle *v,
+        const unsigned d, const double border) {
+    double uc=u->getCentreD(d), vc=v->getCentreD(d);
+    if (uc <= vc && v->getMinD(d,border) < u->getMaxD(d,border))
+        return u->getMaxD(d,border) - v->getMinD(d,border);
+    if (vc <= uc && u->getMinD(d,border) < v->getMaxD(d,border))
+        return v->getMaxD(d,border) - u->getMinD(d,border);
+    return 0;
+}
 bool noRectangleOverlaps(const Rectangles& rs) 
+{
+    return noRectangleOverlaps(rs,Rectangle::xBorder,Rectangle::yBorder);
+}
+bool noRectangleOverlaps(const Rectangles& rs, const double xBorder,
+        const double yBorder) 
 {
     Rectangle *u, *v;
     Rectangles::const_iterator i=rs.begin(), j, e=rs.end();
@@ -672,15 +972,181 @@ bool noRectangleOverlaps(const Rectangles& rs)
         for (j=i+1;j!=e;++j) 
         {
             v=*j;
-            if (u->overlapX(v)>0) 
+            if (overlapD(u,v,0,xBorder)>0) 
             {
-                COLA_ASSERT(u->overlapY(v)==0);
+                COLA_ASSERT(overlapD(u,v,1,yBorder)==0);
             }
         }
     }
     return true;
 }
 
+namespace {
+/*
+ * The rectangles that removeoverlapsIncremental solves again.  A
+ * rectangle pushed into by the subset is added, and so are the rectangles
+ * it would in turn push along, as far as the push reaches; otherwise a
+ * tightly packed layout would only grow by one layer per solve.  The
+ * rectangles are also held in order of their left sides, so that those
+ * near a given one are found without scanning them all.
+ */
+class IncrementalSubset {
+public:
+    IncrementalSubset(const Rectangles& rs, const double xBorder,
+            const double yBorder)
+        : rs(rs), isMember(rs.size(),false), maxWidth(0) {
+        border[0]=xBorder;
+        border[1]=yBorder;
+        vector<std::pair<double,unsigned> > order(rs.size());
+        for(unsigned i=0;i<rs.size();++i) {
+            order[i]=std::make_pair(rs[i]->getMinD(0,0),i);
+            maxWidth=std::max(maxWidth,
+                    rs[i]->getMaxD(0,0)-rs[i]->getMinD(0,0));
+        }
+        std::sort(order.begin(),order.end());
+        minX.resize(order.size());
+        byMinX.resize(order.size());
+        for(unsigned i=0;i<order.size();++i) {
+            minX[i]=order[i].first;
+            byMinX[i]=order[i].second;
+        }
+    }
+    void insert(const unsigned i) {
+        COLA_ASSERT(!isMember[i]);
+        isMember[i]=true;
+        members.push_back(i);
+    }
+    // Adds the rectangles that placed, the current positions of the
+    // members, overlap or push along.  Returns whether any were added.
+    bool grow(const Rectangles& placed) {
+        COLA_ASSERT(placed.size()==members.size());
+        vector<Push> pushes;
+        for(Rectangles::const_iterator j=placed.begin();
+                j!=placed.end();++j) {
+            Window w=window(*j,2*border[0]);
+            for(size_t k=w.first;k<w.second;++k) {
+                const unsigned i=byMinX[k];
+                Rectangle *u=rs[i];
+                if(isMember[i]) {
+                    continue;
+                }
+                double ox=overlapD(u,*j,0,border[0]), 
+                       oy=overlapD(u,*j,1,border[1]);
+                if(ox>0 && oy>0) {
+                    // Assume u is pushed the shorter way out.
+                    Push p;
+                    p.i=i;
+                    p.d=ox<oy?0:1;
+                    p.forward=u->getCentreD(p.d)>=(*j)->getCentreD(p.d);
+                    p.distance=std::min(ox,oy);
+                    insert(i);
+                    pushes.push_back(p);
+                }
+            }
+        }
+        for(size_t k=0;k<pushes.size();++k) {
+            spread(pushes[k],pushes);
+        }
+        return !pushes.empty();
+    }
+    vector<unsigned> members;
+private:
+    struct Push {
+        unsigned i;     // the rectangle pushed
+        unsigned d;     // along this axis
+        bool forward;   // towards larger coordinates
+        double distance;
+    };
+    // The range of byMinX holding the rectangles that might come within
+    // reach of u horizontally.
+    typedef std::pair<size_t,size_t> Window;
+    Window window(const Rectangle *u, const double reach) const {
+        return Window(
+            std::lower_bound(minX.begin(),minX.end(),
+                u->getMinD(0,0)-maxWidth-reach)-minX.begin(),
+            std::upper_bound(minX.begin(),minX.end(),
+                u->getMaxD(0,0)+reach)-minX.begin());
+    }
+    // Adds the rectangles that p pushes along in turn.
+    void spread(const Push p, vector<Push>& pushes) {
+        const Rectangle *u=rs[p.i];
+        const unsigned d=p.d, o=1-d;
+        Window win=window(u,2*border[0]+(d==0?p.distance:0));
+        for(size_t k=win.first;k<win.second;++k) {
+            const unsigned i=byMinX[k];
+            Rectangle *w=rs[i];
+            if(isMember[i] || overlapD(u,w,o,border[o])<=0
+                    || (w->getCentreD(d)>=u->getCentreD(d))!=p.forward) {
+                continue;
+            }
+            double gap=p.forward
+                ? w->getMinD(d,border[d])-u->getMaxD(d,border[d])
+                : u->getMinD(d,border[d])-w->getMaxD(d,border[d]);
+            if(gap<p.distance) {
+                Push q=p;
+                q.i=i;
+                q.distance=p.distance-std::max(gap,0.);
+                insert(i);
+                pushes.push_back(q);
+            }
+        }
+    }
+    const Rectangles& rs;
+    double border[2];
+    vector<bool> isMember;
+    // The left sides of the rectangles in ascending order, and their
+    // indices in rs.
+    vector<double> minX;
+    vector<unsigned> byMinX;
+    double maxWidth;
+};
+}
+unsigned removeoverlapsIncremental(Rectangles& rs,
+        const set<unsigned>& changed, bool thirdPass,
+        const double xBorder, const double yBorder) {
+    const set<unsigned> fixed;
+    const unsigned n=rs.size();
+    if(changed.empty()) {
+        return 0;
+    }
+    IncrementalSubset subset(rs,xBorder,yBorder);
+    Rectangles placed;
+    for(set<unsigned>::const_iterator i=changed.begin();i!=changed.end();++i) {
+        COLA_ASSERT(*i<n);
+        subset.insert(*i);
+        placed.push_back(rs[*i]);
+    }
+    subset.grow(placed);
+    // The subset is solved on copies, so that each attempt starts from the
+    // given positions and rs is only written once it is final.
+    OverlapRemovalWorkspace ws;
+    const vector<unsigned>& members=subset.members;
+    // Each attempt solves the whole subset again, so count every rectangle
+    // solved so far, not just the size of the latest subset.
+    unsigned solved=0;
+    do {
+        solved+=members.size();
+        if(2*solved>n) {
+            // Little would be saved over solving everything.
+            removeoverlaps(rs,fixed,thirdPass,xBorder,yBorder,ws);
+            return n;
+        }
+        const unsigned m=members.size();
+        ws.rects.resize(m);
+        ws.rs.resize(m);
+        for(unsigned i=0;i<m;++i) {
+            ws.rects[i]=*rs[members[i]];
+            ws.rs[i]=&ws.rects[i];
+        }
+        removeoverlaps(ws.rs,fixed,thirdPass,xBorder,yBorder,ws);
+    } while(subset.grow(ws.rs));
+    for(unsigned i=0;i<members.size();++i) {
+        *rs[members[i]]=ws.rects[i];
+    }
+    COLA_ASSERT(noRectangleOverlaps(rs,xBorder,yBorder));
+    return members.size();
+}
+
 // checks if line segment is strictly overlapping.
 // That is, if any point on the line is inside the rectangle.
 bool Rectangle::overlaps(double x1, double y1, double x2, double y2) 
@@ -84,6 +84,14 @@ public:
         ,  minY(Other.minY)
         ,  maxY(Other.maxY)
         ,  overlap(Other.overlap) { }
+    Rectangle& operator=(Rectangle const &Other) {
+        minX=Other.minX;
+        maxX=Other.maxX;
+        minY=Other.minY;
+        maxY=Other.maxY;
+        overlap=Other.overlap;
+        return *this;
+    }
     Rectangle();
     bool isValid(void) const;
     Rectangle unionWith(const Rectangle& rhs) const;
@@ -112,18 +120,37 @@ public:
         COLA_ASSERT(d==0||d==1);
         return ( d == 0 ? getMaxX() : getMaxY() );
     }
+    /**
+     * As getMinD(d), but with the given border rather than xBorder or
+     * yBorder.
+     * @param d axis: 0=horizontal 1=vertical
+     */
+    double getMinD(unsigned const d, double const border) const {
+        COLA_ASSERT(d==0||d==1);
+        return ( d == 0 ? minX : minY ) - border;
+    }
+    /**
+     * As getMaxD(d), but with the given border rather than xBorder or
+     * yBorder.
+     * @param d axis: 0=horizontal 1=vertical
+     */
+    double getMaxD(unsigned const d, double const border) const {
+        COLA_ASSERT(d==0||d==1);
+        return ( d == 0 ? maxX : maxY ) + border;
+    }
     void setMinD(unsigned const d, const double val)
     { if ( d == 0) { minX = val; } else { minY = val; } }
     void setMaxD(unsigned const d, const double val)
     { if ( d == 0) { maxX = val; } else { maxY = val; } }
-    double getCentreX() const { return getMinX()+width()/2.0; }
-    double getCentreY() const { return getMinY()+height()/2.0; }
+    // The borders do not move the centre, so it is found without them.
+    double getCentreX() const { return minX+(maxX-minX)/2.0; }
+    double getCentreY() const { return minY+(maxY-minY)/2.0; }
     /**
      * @param d axis: 0=horizontal 1=vertical
      */
     double getCentreD(unsigned const d) const {
         COLA_ASSERT(d==0||d==1);
-        return getMinD(d)+length(d)/2.0;
+        return ( d == 0 ? getCentreX() : getCentreY() );
     }
     double width() const { return getMaxX()-getMinX(); }
     double height() const { return getMaxY()-getMinY(); }
@@ -142,11 +169,16 @@ public:
         if(d == 0) { moveCentreX(p);
         } else { moveCentreY(p); }
     }
+    // As for getCentreX(), the borders need not be read.
     void moveCentreX(double x) {
-        moveMinX(x-width()/2.0);
+        double w=maxX-minX;
+        minX=x-w/2.0;
+        maxX=minX+w;
     }
     void moveCentreY(double y) {
-        moveMinY(y-height()/2.0);
+        double h=maxY-minY;
+        minY=y-h/2.0;
+        maxY=minY+h;
     }
     void moveCentre(double x, double y) {
         moveCentreX(x);
@@ -221,6 +253,12 @@ public:
      * size considered in one axis to be slightly different to that considered
      * in the other axis for example, to avoid numerical precision problems in
      * the axis-by-axis overlap removal process.
+     *
+     * These are shared by all rectangles.  Code that may run on several
+     * threads at once should leave them alone and pass borders explicitly
+     * to generateXConstraints, generateYConstraints and removeoverlaps,
+     * and use the getMinD and getMaxD overloads that take a border.  The
+     * centre getters and setters do not depend on the borders.
      */
     static double xBorder,yBorder;
     static void setXBorder(double x) {xBorder=x;}
@@ -237,8 +275,15 @@ std::ostream& operator<<(std::ostream& os, vpsc::Rectangle const &r);
 class Variable;
 class Constraint;
 
-void generateXConstraints(const Rectangles& rs, std::vector<Variable*> const & vars, std::vector<Constraint*> & cs, const bool useNeighbourLists);
-void generateYConstraints(std::vector<Rectangle*> const & rs, std::vector<Variable*> const & vars, std::vector<Constraint*> & cs);
+/**
+ * The constraint generators treat each rectangle as being enlarged by
+ * xBorder and yBorder on each side.  These default to the static
+ * Rectangle::xBorder and Rectangle::yBorder, which are not changed.
+ */
+void generateXConstraints(const Rectangles& rs, std::vector<Variable*> const & vars, std::vector<Constraint*> & cs, const bool useNeighbourLists,
+        const double xBorder=Rectangle::xBorder, const double yBorder=Rectangle::yBorder);
+void generateYConstraints(std::vector<Rectangle*> const & rs, std::vector<Variable*> const & vars, std::vector<Constraint*> & cs,
+        const double xBorder=Rectangle::xBorder, const double yBorder=Rectangle::yBorder);
 
 /** 
  * Moves all the rectangles to remove all overlaps.  Heuristic
@@ -260,11 +305,62 @@ void removeoverlaps(Rectangles& rs);
  * @param rs the rectangles which will be moved to remove overlap
  * @param fixed a set of indices to rectangles which should not be moved
  * @param thirdPass optionally run the third horizontal pass described above.
+ * @param xBorder, yBorder borders to add to each rectangle, by default the
+ *        static Rectangle::xBorder and Rectangle::yBorder.  No global state
+ *        is modified, so this may be called from several threads at once
+ *        on different rectangles.
+ */
+void removeoverlaps(Rectangles& rs, const std::set<unsigned>& fixed, bool thirdPass=true,
+        const double xBorder=Rectangle::xBorder, const double yBorder=Rectangle::yBorder);
+
+/**
+ * Removes overlaps independently in each of a batch of rectangle sets, as
+ * removeoverlaps(rs,fixed,thirdPass) would for each set with nothing fixed.
+ * The rectangles of all the sets are given in flat arrays, set i holding
+ * the entries from setStarts[i] up to (but not including) setStarts[i+1].
+ * Solver scratch memory is reused from one set to the next, which makes
+ * this cheaper than calling removeoverlaps for many small sets.
+ * @param numSets the number of rectangle sets
+ * @param setStarts numSets+1 offsets into the other arrays
+ * @param centreX, centreY centres of the rectangles, overwritten with the
+ *        new centres
+ * @param width, height dimensions of the rectangles
+ * @param thirdPass optionally run the third horizontal pass
+ * @param concurrently if true, and the library was built with OpenMP,
+ *        the sets are divided between threads
+ * @param xBorder, yBorder borders to add to each rectangle
+ */
+void removeoverlaps(const unsigned numSets, const unsigned *setStarts,
+        double *centreX, double *centreY,
+        const double *width, const double *height,
+        bool thirdPass=true, bool concurrently=false,
+        const double xBorder=Rectangle::xBorder, const double yBorder=Rectangle::yBorder);
+
+/**
+ * Removes the overlaps caused by moving or resizing some rectangles of a
+ * layout that was previously free of overlap, e.g. after removeoverlaps.
+ * Rather than solving for all of the rectangles again, the changed
+ * rectangles and those they would push aside are solved as in
+ * removeoverlaps(rs), and any other rectangle that the result then
+ * overlaps is added and the subproblem solved again, until it no longer
+ * pushes into the rest of the layout.  Only the constraints between
+ * rectangles of the subproblem are generated, and rectangles outside it
+ * are not moved.  Should the subproblems solved add up to more than half
+ * of the rectangles, all of them are solved instead.
+ * @param rs the rectangles, with the changed ones at their new positions
+ *   and sizes
+ * @param changed indices of the rectangles that were moved or resized
+ * @param thirdPass as for removeoverlaps
+ * @return the number of rectangles in the subproblem finally solved
  */
-void removeoverlaps(Rectangles& rs, const std::set<unsigned>& fixed, bool thirdPass=true);
+unsigned removeoverlapsIncremental(Rectangles& rs,
+        const std::set<unsigned>& changed, bool thirdPass=true,
+        const double xBorder=Rectangle::xBorder, const double yBorder=Rectangle::yBorder);
 
 // Useful for assertions:
 bool noRectangleOverlaps(const Rectangles& rs);
+bool noRectangleOverlaps(const Rectangles& rs, const double xBorder,
+        const double yBorder);
 
 struct delete_object
 {
@@ -34,6 +34,7 @@
 #include <cmath>
 #include <sstream>
 #include <map>
+#include <set>
 #include <cfloat>
 
 #include "libvpsc/constraint.h"
@@ -56,10 +57,9 @@ static const double ZERO_UPPERBOUND=-1e-10;
 static const double LAGRANGIAN_TOLERANCE=-1e-4;
 
 IncSolver::IncSolver(vector<Variable*> const &vs, vector<Constraint *> const &cs) 
-    : Solver(vs,cs) {
-    inactive=cs;
-    for(Constraints::iterator i=inactive.begin();i!=inactive.end();++i) {
-        (*i)->active=false;
+    : Solver(vs,cs), splitCnt(0), satisfyCnt(0), blocksChanged(false) {
+    for(unsigned i=0;i<m;++i) {
+        cs[i]->active=false;
     }
 }
 Solver::Solver(vector<Variable*> const &vs, vector<Constraint*> const &cs) : m(cs.size()), cs(cs), n(vs.size()), vs(vs) {
@@ -86,7 +86,7 @@ Solver::~Solver() {
 void Solver::printBlocks() {
 #ifdef LIBVPSC_LOGGING
     ofstream f(LOGFILE,ios::app);
-    for(set<Block*>::iterator i=bs->begin();i!=bs->end();++i) {
+    for(Blocks::const_iterator i=bs->begin();i!=bs->end();++i) {
         Block *b=*i;
         f<<"  "<<*b<<endl;
     }
@@ -151,12 +151,8 @@ void Solver::refine() {
     while(!solved&&maxtries>0) {
         solved=true;
         maxtries--;
-        for(set<Block*>::const_iterator i=bs->begin();i!=bs->end();++i) {
-            Block *b=*i;
-            b->setUpInConstraints();
-            b->setUpOutConstraints();
-        }
-        for(set<Block*>::const_iterator i=bs->begin();i!=bs->end();++i) {
+        // The blocks' constraint heaps are set up on demand by the split.
+        for(Blocks::const_iterator i=bs->begin();i!=bs->end();++i) {
             Block *b=*i;
             Constraint *c=b->findMinLM();
             if(c!=NULL && c->lm<LAGRANGIAN_TOLERANCE) {
@@ -195,13 +191,36 @@ bool Solver::solve() {
 }
 
 bool IncSolver::solve() {
+    if(blocksChanged) {
+        delete bs;
+        bs=new Blocks(vs);
+        for(unsigned i=0;i<m;++i) {
+            cs[i]->active=false;
+        }
+        blocksChanged=false;
+    }
+    return resolve();
+}
+/**
+ * Re-optimise starting from the blocks left by the previous call.  Since
+ * the blocks are only split where that lowers the cost, a small change to
+ * the desired positions usually needs one or two satisfy() passes rather
+ * than rebuilding the blocks from singletons.
+ */
+bool IncSolver::resolve() {
 #ifdef LIBVPSC_LOGGING
     ofstream f(LOGFILE,ios::app);
     f<<"solve_inc()..."<<endl;
 #endif
+    satisfyCnt=1;
     satisfy();
     double lastcost = DBL_MAX, cost = bs->cost();
-    while(fabs(lastcost-cost)>0.0001) {
+    // Blocks split at the start of satisfy() may be merged again with no
+    // change in cost, so only stop once nothing was split.  Limit the
+    // number of iterations in case splits and merges cycle.
+    unsigned maxtries=100;
+    while((fabs(lastcost-cost)>0.0001 || splitCnt>0) && --maxtries) {
+        satisfyCnt++;
         satisfy();
         lastcost=cost;
         cost = bs->cost();
@@ -209,6 +228,8 @@ bool IncSolver::solve() {
         f<<"  bs->size="<<bs->size()<<", cost="<<cost<<endl;
 #endif
     }
+    // Reaching the limit means splits and merges really did cycle.
+    COLA_ASSERT(maxtries>0);
     copyResult();
     return bs->size()!=n; 
 }
@@ -218,7 +239,8 @@ bool IncSolver::solve() {
  *
  *  - move blocks to new positions
  *  - repeatedly merge across most violated constraint until no more
- *    violated constraints exist
+ *    violated constraints exist (the candidates are kept in a CBuffer,
+ *    see cbuffer.h)
  *
  * Note: there is a special case to handle when the most violated constraint
  * is between two variables in the same block.  Then, we must split the block
@@ -230,17 +252,19 @@ bool IncSolver::satisfy() {
     ofstream f(LOGFILE,ios::app);
     f<<"satisfy_inc()..."<<endl;
 #endif
+    blocksChanged=true;
     splitBlocks();
     //long splitCtr = 0;
     Constraint* v = NULL;
-    //CBuffer buffer(inactive);
-    while ( (v = mostViolated(inactive)) && 
-            (v->equality || ((v->slack() < ZERO_UPPERBOUND) && !v->active)) ) 
+    CBuffer buffer(cs);
+    while ( (v = buffer.mostViolated()) ) 
     {
         COLA_ASSERT(!v->active);
         Block *lb = v->left->block, *rb = v->right->block;
         if(lb != rb) {
-            lb->merge(rb,v);
+            // The smaller block is absorbed and moves the furthest, the
+            // constraints of the other are rechecked lazily.
+            buffer.moved(lb->merge(rb,v)==lb?rb:lb);
         } else {
             if(lb->isActiveDirectedPathBetween(v->right,v->left)) {
                 // cycle found, relax the violated, cyclic constraint
@@ -260,7 +284,6 @@ bool IncSolver::satisfy() {
                     =lb->splitBetween(v->left,v->right,lb,rb);
                 if(splitConstraint!=NULL) {
                     COLA_ASSERT(!splitConstraint->active);
-                    inactive.push_back(splitConstraint);
                 } else {
                     v->unsatisfiable=true;
                     continue;
@@ -281,12 +304,12 @@ bool IncSolver::satisfy() {
             if(v->slack()>=0) {
                 COLA_ASSERT(!v->active);
                 // v was satisfied by the above split!
-                inactive.push_back(v);
                 bs->insert(lb);
                 bs->insert(rb);
             } else {
                 bs->insert(lb->merge(rb,v));
             }
+            buffer.moved(lb->vars->size()<rb->vars->size()?lb:rb);
         }
         bs->cleanup();
 #ifdef LIBVPSC_LOGGING
@@ -323,7 +346,7 @@ void IncSolver::moveBlocks() {
     ofstream f(LOGFILE,ios::app);
     f<<"moveBlocks()..."<<endl;
 #endif
-    for(set<Block*>::const_iterator i(bs->begin());i!=bs->end();++i) {
+    for(Blocks::const_iterator i(bs->begin());i!=bs->end();++i) {
         Block *b = *i;
         b->updateWeightedPosition();
         //b->posn = b->wposn / b->weight;
@@ -339,7 +362,7 @@ void IncSolver::splitBlocks() {
     moveBlocks();
     splitCnt=0;
     // Split each block if necessary on min LM
-    for(set<Block*>::const_iterator i(bs->begin());i!=bs->end();++i) {
+    for(Blocks::const_iterator i(bs->begin());i!=bs->end();++i) {
         Block* b = *i;
         Constraint* v=b->findMinLM();
         if(v!=NULL && v->lm < LAGRANGIAN_TOLERANCE) {
@@ -361,7 +384,6 @@ void IncSolver::splitBlocks() {
             bs->insert(r);
             b->deleted=true;
             COLA_ASSERT(!v->active);
-            inactive.push_back(v);
 #ifdef LIBVPSC_LOGGING
             f<<"  new blocks: "<<*l<<" and "<<*r<<endl;
 #endif
@@ -374,43 +396,14 @@ void IncSolver::splitBlocks() {
     bs->cleanup();
 }
 
-/**
- * Scan constraint list for the most violated constraint, or the first equality
- * constraint
- */
-Constraint* IncSolver::mostViolated(Constraints &l) {
-    double minSlack = DBL_MAX;
-    Constraint* v=NULL;
-#ifdef LIBVPSC_LOGGING
-    ofstream f(LOGFILE,ios::app);
-    f<<"Looking for most violated..."<<endl;
-#endif
-    Constraints::iterator end = l.end();
-    Constraints::iterator deletePoint = end;
-    for(Constraints::iterator i=l.begin();i!=end;++i) {
-        Constraint *c=*i;
-        double slack = c->slack();
-        if(c->equality || slack < minSlack) {
-            minSlack=slack;    
-            v=c;
-            deletePoint=i;
-            if(c->equality) break;
+void IncSolver::updateDesiredPositions(
+        std::valarray<double> const &desiredPositions) {
+    COLA_ASSERT(desiredPositions.size()==n);
+    for(unsigned i=0;i<n;++i) {
+        if(!vs[i]->fixedDesiredPosition) {
+            vs[i]->desiredPosition=desiredPositions[i];
         }
     }
-    // Because the constraint list is not order dependent we just
-    // move the last element over the deletePoint and resize
-    // downwards.  There is always at least 1 element in the
-    // vector because of search.
-    if ( (deletePoint != end) && 
-         (((minSlack < ZERO_UPPERBOUND) && !v->active) || v->equality) )
-    {
-        *deletePoint = l[l.size()-1];
-        l.resize(l.size()-1);
-    }
-#ifdef LIBVPSC_LOGGING
-    f<<"  most violated is: "<<*v<<endl;
-#endif
-    return v;
 }
 
 struct node {
@@ -468,13 +461,13 @@ bool Solver::constraintGraphIsCyclic(const unsigned n, Variable* const vs[]) {
 bool Solver::blockGraphIsCyclic() {
     map<Block*, node*> bmap;
     vector<node*> graph;
-    for(set<Block*>::const_iterator i=bs->begin();i!=bs->end();++i) {
+    for(Blocks::const_iterator i=bs->begin();i!=bs->end();++i) {
         Block *b=*i;
         node *u=new node;
         graph.push_back(u);
         bmap[b]=u;
     }
-    for(set<Block*>::const_iterator i=bs->begin();i!=bs->end();++i) {
+    for(Blocks::const_iterator i=bs->begin();i!=bs->end();++i) {
         Block *b=*i;
         b->setUpInConstraints();
         Constraint *c=b->findMinInConstraint();
@@ -43,6 +43,7 @@
 #define SEEN_LIBVPSC_SOLVE_VPSC_H
 
 #include <vector>
+#include <valarray>
 #include "libvpsc/exceptions.h"
 
 /**
@@ -89,15 +90,31 @@ private:
 class IncSolver : public Solver {
 public:
 	unsigned splitCnt;
+	// Number of satisfy() passes made by the last solve() or resolve().
+	// Both stop after 100 passes even if blocks are still being split;
+	// debug builds assert that this limit is not reached.
+	unsigned satisfyCnt;
 	bool satisfy();
+	// Solves from scratch: blocks left by an earlier satisfy(), solve()
+	// or resolve() are first broken up into single variables again.
 	bool solve();
 	void moveBlocks();
 	void splitBlocks();
+	// Sets new desired positions, given in the order of the variables
+	// passed to the constructor, so there must be one per variable.
+	// Variables with fixedDesiredPosition set keep their current one.
+	// The blocks and active constraints are kept, so a following
+	// resolve() starts from the previous solution.
+	void updateDesiredPositions(std::valarray<double> const &desiredPositions);
+	// Re-optimises from the current block structure, e.g. after
+	// updateDesiredPositions().  Before any solve this is the same as
+	// solve().
+	bool resolve();
 	IncSolver(std::vector<Variable*> const &vs, std::vector<Constraint*> const &cs);
 private:
-	Constraints inactive;
+	// Whether bs has been changed since the blocks were set up.
+	bool blocksChanged;
 	Constraints violated;
-	Constraint* mostViolated(Constraints &l);
 };
 }
 #endif // SEEN_LIBVPSC_SOLVE_VPSC_H
@@ -612,6 +612,142 @@ double test12[][4]={
 {1.16362,3.67328,0.29063,3.01001},
 };	
 unsigned n12=10;
+// Removes overlap in a batch of random sets, one at a time with
+// removeoverlaps(rs) and then with the batch interface, both serially and
+// concurrently, and checks that all three give the same centres.
+bool testBatch() {
+	const unsigned sets=200;
+	vector<unsigned> starts(1,0);
+	vector<double> x, y, w, h, sx, sy;
+	for(unsigned s=0;s<sets;++s) {
+		vector<Rectangle*> rs;
+		generateRandomRects(5+rand()%50,rs);
+		for(unsigned i=0;i<rs.size();++i) {
+			x.push_back(rs[i]->getCentreX());
+			y.push_back(rs[i]->getCentreY());
+			w.push_back(rs[i]->width());
+			h.push_back(rs[i]->height());
+		}
+		removeoverlaps(rs);
+		for(unsigned i=0;i<rs.size();++i) {
+			sx.push_back(rs[i]->getCentreX());
+			sy.push_back(rs[i]->getCentreY());
+			delete rs[i];
+		}
+		starts.push_back(x.size());
+	}
+	bool ok=true;
+	for(int concurrently=0;concurrently<2;++concurrently) {
+		vector<double> bx(x), by(y);
+		clock_t starttime = clock();
+		removeoverlaps(sets,&starts[0],&bx[0],&by[0],&w[0],&h[0],
+				true,concurrently!=0);
+		double duration = (double)(clock() - starttime)/CLOCKS_PER_SEC;
+		cout << "batch of " << sets << " sets, concurrently=" << concurrently
+			<< ": " << duration << "s" << endl;
+		for(unsigned i=0;i<x.size();++i) {
+			if(fabs(bx[i]-sx[i])>1e-6||fabs(by[i]-sy[i])>1e-6) {
+				ok=false;
+			}
+		}
+	}
+	return ok;
+}
+bool overlapFree(vector<Rectangle*> &rs) {
+	for(unsigned i=0;i<rs.size();++i) {
+		for(unsigned j=i+1;j<rs.size();++j) {
+			if(rs[i]->overlapX(rs[j])>0 && rs[i]->overlapY(rs[j])>0) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+// Removes overlap from a random layout, then moves and grows a few of the
+// rectangles and removes overlap again, incrementally and from scratch.
+// Checks that the incremental result is free of overlap and that it
+// leaves the rectangles outside the solved subproblem where they were.
+bool testIncremental() {
+	const unsigned n=2000, moves=5;
+	// Leave some room between the rectangles, as in a diagram being
+	// edited.
+	const double fld_size=3*sqrt(5.0*n/2.0);
+	vector<Rectangle*> rs(n);
+	for(unsigned i=0;i<n;++i) {
+		double x=getRand(fld_size), y=getRand(fld_size);
+		rs[i]=new Rectangle(x,x+1e-4+getRand(5),y,y+1e-4+getRand(5));
+	}
+	removeoverlaps(rs);
+	set<unsigned> changed;
+	while(changed.size()<moves) {
+		unsigned i=rand()%n;
+		if(!changed.insert(i).second) continue;
+		Rectangle *r=rs[i];
+		double dx=getRand(10)-5, dy=getRand(10)-5;
+		*r=Rectangle(r->getMinX()+dx,r->getMaxX()+dx+getRand(3),
+				r->getMinY()+dy,r->getMaxY()+dy+getRand(3));
+	}
+	vector<Rectangle*> full(n);
+	vector<Rectangle> before(n);
+	for(unsigned i=0;i<n;++i) {
+		full[i]=new Rectangle(*rs[i]);
+		before[i]=*rs[i];
+	}
+	clock_t starttime = clock();
+	unsigned solved=removeoverlapsIncremental(rs,changed);
+	double incremental = (double)(clock() - starttime)/CLOCKS_PER_SEC;
+	starttime = clock();
+	removeoverlaps(full);
+	double scratch = (double)(clock() - starttime)/CLOCKS_PER_SEC;
+	cout << "moved " << moves << " of " << n << " rectangles: incremental "
+		<< incremental << "s (" << solved << " rectangles solved), full "
+		<< scratch << "s" << endl;
+	unsigned unmoved=0;
+	for(unsigned i=0;i<n;++i) {
+		if(rs[i]->getCentreX()==before[i].getCentreX()
+				&& rs[i]->getCentreY()==before[i].getCentreY()) {
+			unmoved++;
+		}
+	}
+	bool ok=overlapFree(rs) && unmoved>=n-solved;
+	for(unsigned i=0;i<n;++i) {
+		delete rs[i];
+		delete full[i];
+	}
+	return ok;
+}
+// Grows the middle rectangle of a tightly packed grid, so that each
+// incremental attempt pushes into more of the grid.  The attempts add up to
+// more than half of the rectangles, so removeoverlapsIncremental should
+// fall back to solving all of them, giving the same result as
+// removeoverlaps.
+bool testIncrementalFallback() {
+	const unsigned side=10, n=side*side, grown=side*side/2+side/2;
+	vector<Rectangle*> rs(n), full(n);
+	for(unsigned i=0;i<n;++i) {
+		double x=(i%side)*1.1, y=(i/side)*1.1;
+		if(i==grown) {
+			rs[i]=new Rectangle(x-1,x+2,y-1,y+2);
+		} else {
+			rs[i]=new Rectangle(x,x+1,y,y+1);
+		}
+		full[i]=new Rectangle(*rs[i]);
+	}
+	set<unsigned> changed;
+	changed.insert(grown);
+	unsigned solved=removeoverlapsIncremental(rs,changed);
+	removeoverlaps(full);
+	bool ok=solved==n && overlapFree(rs);
+	for(unsigned i=0;i<n;++i) {
+		if(rs[i]->getCentreX()!=full[i]->getCentreX()
+				|| rs[i]->getCentreY()!=full[i]->getCentreY()) {
+			ok=false;
+		}
+		delete rs[i];
+		delete full[i];
+	}
+	return ok;
+}
 int main() {
 	double c,t;
 	vector<Rectangle*> rs;
@@ -656,5 +792,17 @@ int main() {
 		time/=repeats;
 		cout << i << "," << time << "," << disp << endl;
 	}
+	if(!testBatch()) {
+		cout << "batch removeoverlaps gave different results" << endl;
+		return 1;
+	}
+	if(!testIncremental()) {
+		cout << "incremental removeoverlaps left overlaps" << endl;
+		return 1;
+	}
+	if(!testIncrementalFallback()) {
+		cout << "incremental removeoverlaps did not fall back" << endl;
+		return 1;
+	}
     return 0;
 }
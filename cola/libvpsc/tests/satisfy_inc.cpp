@@ -28,6 +28,7 @@
 #include <libvpsc/constraint.h>
 #include <libvpsc/solve_VPSC.h>
 #include <algorithm>
+#include <valarray>
 #include <cstdio>
 #include <ctime>
 #include <cmath>
@@ -559,6 +560,83 @@ new Constraint(a[3],a[4],3)};
 	cout << "Test 13... done." << endl;
 }
 
+// A satisfy() pass of solve() splits blocks and merges them again without
+// changing the cost, so stopping when the cost stops changing leaves the
+// variables up to 0.625 from the optimum.
+void test14() {
+	cout << "Test 14..." << endl;
+	Variable *a[] = {
+		new Variable(0,5,1,1),
+		new Variable(1,8,1,1),
+		new Variable(2,3,1,1),
+		new Variable(3,9,1,1),
+		new Variable(4,4,1,1),
+		new Variable(5,5,1,1),
+		new Variable(6,9,1,1),
+		new Variable(7,7,1,1)};
+	Constraint *c[] = {
+		new Constraint(a[0],a[2],3),
+		new Constraint(a[0],a[3],3),
+		new Constraint(a[1],a[2],3),
+		new Constraint(a[2],a[4],3),
+		new Constraint(a[3],a[4],3),
+		new Constraint(a[3],a[5],3),
+		new Constraint(a[5],a[6],3),
+		new Constraint(a[6],a[7],3)};
+	unsigned int n = sizeof(a)/sizeof(Variable*);
+	unsigned int m = sizeof(c)/sizeof(Constraint*);
+	double expected[]={1,2,5,4,8,7,10,13};
+	checkResult(n,a,m,c,expected);
+	cout << "Test 14... done." << endl;
+}
+
+// Moves the desired positions of test 14's problem, then solves it again
+// with a new solver, with solve() on the old solver and with resolve() on
+// another.  solve() has to start again from single-variable blocks, so it
+// makes the same satisfy() passes as a new solver, while resolve() starts
+// from the old blocks.  All three reach the same optimum.
+void test15() {
+	cout << "Test 15..." << endl;
+	double desired[]={5,8,3,9,4,5,9,7};
+	const unsigned n=sizeof(desired)/sizeof(double);
+	Variables vs;
+	for(unsigned i=0;i<n;i++) {
+		vs.push_back(new Variable(i,desired[i],1,1));
+	}
+	unsigned pairs[][2]={{0,2},{0,3},{1,2},{2,4},{3,4},{3,5},{5,6},{6,7}};
+	Constraints cs;
+	for(unsigned i=0;i<sizeof(pairs)/sizeof(pairs[0]);i++) {
+		cs.push_back(new Constraint(vs[pairs[i][0]],vs[pairs[i][1]],3));
+	}
+	IncSolver cold(vs,cs), warm(vs,cs);
+	cold.solve();
+	warm.solve();
+	// Swap the desired positions of the first two variables.
+	valarray<double> moved(desired,n);
+	std::swap(moved[0],moved[1]);
+	cold.updateDesiredPositions(moved);
+	cold.solve();
+	valarray<double> coldPositions(n);
+	for(unsigned i=0;i<n;i++) coldPositions[i]=vs[i]->finalPosition;
+	warm.updateDesiredPositions(moved);
+	warm.resolve();
+	valarray<double> warmPositions(n);
+	for(unsigned i=0;i<n;i++) warmPositions[i]=vs[i]->finalPosition;
+	IncSolver fresh(vs,cs);
+	fresh.solve();
+	cout << "  satisfy passes: new solver " << fresh.satisfyCnt
+		<< ", solve() " << cold.satisfyCnt
+		<< ", resolve() " << warm.satisfyCnt << endl;
+	assert(cold.satisfyCnt==fresh.satisfyCnt);
+	for(unsigned i=0;i<n;i++) {
+		assert(approxEquals(coldPositions[i],vs[i]->finalPosition));
+		assert(approxEquals(warmPositions[i],vs[i]->finalPosition));
+	}
+	for(unsigned i=0;i<cs.size();i++) delete cs[i];
+	for(unsigned i=0;i<n;i++) delete vs[i];
+	cout << "Test 15... done." << endl;
+}
+
 // n=number vars
 // m=max constraints per var
 void rand_test(unsigned n, unsigned m) {
@@ -654,6 +732,8 @@ int main() {
 	test11();
 	test12();
 	test13();
+	test14();
+	test15();
 	for(int i=0;i<1000;i++) {
 		if(i%100==0) cout << "i=" << i << endl;
 		rand_test(100,3);
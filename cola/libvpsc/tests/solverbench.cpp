@@ -0,0 +1,188 @@
+/*
+ * vim: ts=4 sw=4 et tw=0 wm=0
+ *
+ * libvpsc - A solver for the problem of Variable Placement with
+ *           Separation Constraints.
+ *
+ * Copyright (C) 2026  Adaptagrams contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library in the file LICENSE; if not,
+ * write to the Free Software Foundation, Inc., 59 Temple Place,
+ * Suite 330, Boston, MA  02111-1307  USA
+ *
+*/
+
+// Times the two ways libcola drives the solver, and checks that the faster
+// variant of each gives a feasible answer:
+//  - libcola's gradient projection: one larger problem, satisfied again
+//    after each change to the desired positions (new IncSolver per step
+//    vs. one reused IncSolver).
+//  - libcola's layouts solving to optimality after each step (cold solve()
+//    vs. updateDesiredPositions() and resolve()), counting satisfy passes.
+
+#include <libvpsc/variable.h>
+#include <libvpsc/constraint.h>
+#include <libvpsc/solve_VPSC.h>
+#include <vector>
+#include <valarray>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+using namespace std;
+using namespace vpsc;
+
+static inline double getRand(const double range) {
+	return range*rand()/(RAND_MAX+1.0);
+}
+static double elapsedMs(const clock_t start) {
+	return 1000.0*(clock()-start)/CLOCKS_PER_SEC;
+}
+static bool feasible(const Constraints &cs) {
+	for(Constraints::const_iterator i=cs.begin();i!=cs.end();++i) {
+		Constraint *c=*i;
+		if(c->right->finalPosition-c->left->finalPosition<c->gap-0.0001) {
+			return false;
+		}
+	}
+	return true;
+}
+static double cost(const Variables &vs) {
+	double total=0;
+	for(Variables::const_iterator i=vs.begin();i!=vs.end();++i) {
+		double d=(*i)->finalPosition-(*i)->desiredPosition;
+		total+=(*i)->weight*d*d;
+	}
+	return total;
+}
+
+static bool benchGradientProjection() {
+	const unsigned n=2000, steps=50;
+	srand(2);
+	Variables vs;
+	Constraints cs;
+	for(unsigned i=0;i<n;i++) {
+		vs.push_back(new Variable(i,getRand(10000)));
+	}
+	for(unsigned i=0;i<4*n;i++) {
+		unsigned l=rand()%n, r=rand()%n;
+		if(l==r) continue;
+		if(l>r) swap(l,r);
+		cs.push_back(new Constraint(vs[l],vs[r],getRand(10)));
+	}
+	vector<double> start(n);
+	for(unsigned i=0;i<n;i++) start[i]=vs[i]->desiredPosition;
+
+	bool ok=true;
+	double ms[2];
+	for(int reuse=0;reuse<2;reuse++) {
+		srand(3);
+		for(unsigned i=0;i<n;i++) vs[i]->desiredPosition=start[i];
+		clock_t t=clock();
+		IncSolver *solver=reuse?new IncSolver(vs,cs):NULL;
+		for(unsigned s=0;s<steps;s++) {
+			for(unsigned i=0;i<n;i++) {
+				vs[i]->desiredPosition+=getRand(20)-10;
+			}
+			if(reuse) {
+				solver->satisfy();
+			} else {
+				IncSolver fresh(vs,cs);
+				fresh.satisfy();
+			}
+			// Move on from the projected positions, as gradient
+			// projection does.
+			for(unsigned i=0;i<n;i++) {
+				vs[i]->desiredPosition=vs[i]->finalPosition;
+			}
+		}
+		ms[reuse]=elapsedMs(t);
+		ok=feasible(cs) && ok;
+		delete solver;
+	}
+	printf("gradient projection, %d vars, %d steps: "
+			"new solver %.1fms, reused solver %.1fms\n",n,steps,ms[0],ms[1]);
+	for(unsigned i=0;i<cs.size();i++) delete cs[i];
+	for(unsigned i=0;i<n;i++) delete vs[i];
+	return ok;
+}
+
+static bool benchResolve() {
+	const unsigned n=2000, steps=20;
+	srand(4);
+	Variables vs;
+	Constraints cs;
+	for(unsigned i=0;i<n;i++) {
+		vs.push_back(new Variable(i,getRand(10000)));
+	}
+	for(unsigned i=0;i<2*n;i++) {
+		unsigned l=rand()%n, r=rand()%n;
+		if(l==r) continue;
+		if(l>r) swap(l,r);
+		cs.push_back(new Constraint(vs[l],vs[r],getRand(10)));
+	}
+	vector<double> start(n);
+	for(unsigned i=0;i<n;i++) start[i]=vs[i]->desiredPosition;
+
+	// One solver is kept for all the steps, and given the new desired
+	// positions by updateDesiredPositions().  0: solve(), which starts
+	// again from single-variable blocks, 1: resolve()
+	bool ok=true;
+	double ms[2];
+	unsigned passes[2];
+	vector<double> costs[2];
+	for(int variant=0;variant<2;variant++) {
+		srand(5);
+		valarray<double> desired(&start[0],n);
+		for(unsigned i=0;i<n;i++) vs[i]->desiredPosition=start[i];
+		passes[variant]=0;
+		clock_t t=clock();
+		IncSolver solver(vs,cs);
+		solver.solve();
+		for(unsigned s=0;s<steps;s++) {
+			for(unsigned i=0;i<n;i++) {
+				desired[i]+=getRand(20)-10;
+			}
+			solver.updateDesiredPositions(desired);
+			if(variant==0) {
+				solver.solve();
+			} else {
+				solver.resolve();
+			}
+			passes[variant]+=solver.satisfyCnt;
+			costs[variant].push_back(cost(vs));
+		}
+		ms[variant]=elapsedMs(t);
+		ok=feasible(cs) && ok;
+	}
+	for(unsigned s=0;s<steps;s++) {
+		if(fabs(costs[0][s]-costs[1][s])>0.001*(1+fabs(costs[0][s]))) {
+			printf("  resolve() cost differs from cold solve at step %d\n",s);
+			ok=false;
+		}
+	}
+	printf("solve after each step, %d vars, %d steps: cold %.1fms "
+			"(%d passes), resolve %.1fms (%d passes)\n",
+			n,steps,ms[0],passes[0],ms[1],passes[1]);
+	for(unsigned i=0;i<cs.size();i++) delete cs[i];
+	for(unsigned i=0;i<n;i++) delete vs[i];
+	return ok;
+}
+
+int main() {
+	bool ok=benchGradientProjection();
+	ok=benchResolve() && ok;
+	return ok?0:1;
+}